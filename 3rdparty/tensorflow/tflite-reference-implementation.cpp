@@ -9,9 +9,12 @@
 #include <cstdint>
 #include <vector>
 #include <cmath>
+#include <cstring>
 
 #include <assert.h>
 
+#include "../../tensor.h"
+
 namespace tflite {
 
 /// some common macros used in the code
@@ -55,10 +58,11 @@ struct PaddingValues {
 };
 
 // from: tensorflow/lite/kernels/internal/types.h
-class RuntimeShape : public std::vector<unsigned> {
+// based on our TensorShape to avoid allocations when shapes are passed to operators
+class RuntimeShape : public TensorShape {
 public:
 	RuntimeShape() { }
-	RuntimeShape(const std::vector<unsigned> &v) : std::vector<unsigned>(v) { }
+	RuntimeShape(const TensorShape &s) : TensorShape(s) { }
 	RuntimeShape(unsigned d1) {push_back(d1);}
 	RuntimeShape(unsigned d1, unsigned d2) {push_back(d1); push_back(d2);}
 	RuntimeShape(unsigned d1, unsigned d2, unsigned d3) {push_back(d1); push_back(d2); push_back(d3);}
@@ -73,7 +77,7 @@ public:
 			sz *= *i;
 		return sz;
 	}
-	inline const unsigned* DimsData() const { return &(*this)[0]; }
+	inline const unsigned* DimsData() const { return begin(); }
 	inline static RuntimeShape ExtendedShape(int new_shape_size, const RuntimeShape& shape) {
 		return RuntimeShape(new_shape_size, shape, 1);
 	}
@@ -1016,8 +1020,6 @@ inline void PadImageStyle(const tflite::PadParams& op_params,
 // exporting this functionality by wrapping it in our API
 //
 
-#include "../../tensor.h"
-
 namespace NnOperators {
 
 void Conv2D(
@@ -4,6 +4,7 @@
 #include "plugin-interface.h"
 #include "nn-types.h"
 #include "tensor.h"
+#include "tensor-data.h"
 #include "nn-operators.h"
 #include "image.h"
 #include "misc.h"
@@ -16,6 +17,7 @@
 #include <functional>
 #include <cmath>
 #include <cstring>
+#include <algorithm>
 
 #include <assert.h>
 
@@ -56,7 +58,7 @@ bool buildComputeInputs(
 	std::array<unsigned,4> imageRegion,
 	std::tuple<InputNormalizationRange,InputNormalizationColorOrder> inputNormalization,
 	std::shared_ptr<float> &inputTensor, const TensorShape &inputShape,
-	std::map<PI::TensorId, std::shared_ptr<const float>> &inputs, // output the set of inputs
+	std::map<PI::TensorId, TensorData> &inputs, // output the set of inputs
 	std::function<void(PI::TensorId)> cbTensorComputed,
 	std::function<void(const std::string&)> cbWarningMessage)
 {
@@ -67,15 +69,15 @@ bool buildComputeInputs(
 	auto modelInputs = model->getInputs();
 
 	// input tensor is either reused, or reallocated when alterations are needed
-	auto convertInputImage = [&](PI::TensorId tensorId, TensorShape requiredShape, std::shared_ptr<const float> &inputImage) {
-		inputImage = inputTensor; // initially assign with inputShape, but replace later with a newly allocated one if any transformations are performed
+	auto convertInputImage = [&](PI::TensorId tensorId, TensorShape requiredShape, TensorData &input) {
+		std::shared_ptr<const float> inputImage = inputTensor; // initially assign with inputShape, but replace later with a newly allocated one if any transformations are performed
 		float *inputAllocated = nullptr; // keep track of new allocations
 		TensorShape myInputShape = inputShape;
 
 		/// extract the region if required
 
 		if (imageRegion[0]!=0 || imageRegion[1]!=0 || imageRegion[2]+1!=myInputShape[1] || imageRegion[3]+1!=myInputShape[0]) {
-			inputImage.reset((inputAllocated = Image::regionOfImage(inputImage.get(), myInputShape, imageRegion)));
+			inputImage.reset((inputAllocated = Image::regionOfImage(inputImage.get(), myInputShape, imageRegion)), std::default_delete<float[]>());
 			myInputShape = {imageRegion[3]-imageRegion[1]+1, imageRegion[2]-imageRegion[0]+1, myInputShape[2]};
 		}
 
@@ -109,7 +111,7 @@ bool buildComputeInputs(
 
 			// now we have requiredShape=[H,W,C], resize the image if needed
 			if (myInputShape != requiredShape)
-				inputImage.reset((inputAllocated = Image::resizeImage(inputImage.get(), myInputShape, requiredShape)));
+				inputImage.reset((inputAllocated = Image::resizeImage(inputImage.get(), myInputShape, requiredShape)), std::default_delete<float[]>());
 		}
 
 		/// normalize input
@@ -119,7 +121,7 @@ bool buildComputeInputs(
 
 			const float *src = inputImage.get();
 			if (!inputAllocated) // need to allocate because we change the data, otherwise use the allocated above one
-				inputImage.reset((inputAllocated = new float[inputTensorSize]));
+				inputImage.reset((inputAllocated = new float[inputTensorSize]), std::default_delete<float[]>());
 
 			// helpers
 			auto normalizeRange = [](const float *src, float *dst, size_t sz, float min, float max) {
@@ -203,12 +205,13 @@ bool buildComputeInputs(
 			}
 		}
 
+		input = TensorData::adopt(PI::DataType_Float32, model->getTensorShape(tensorId), inputImage);
 		return true;
 	};
-	auto convertInputFromJsonFile = [](PI::TensorId tensorId, const TensorShape &requiredShape, std::shared_ptr<const float> &inputTensor) {
+	auto convertInputFromJsonFile = [](PI::TensorId tensorId, const TensorShape &requiredShape, TensorData &inputTensor) {
 		std::shared_ptr<const float> foundTensor;
 		if (Tensor::readTensorDataAsJson(CSTR("tensor#" << tensorId << ".json"), requiredShape, foundTensor)) { // match the name with one in main-window.cpp
-			inputTensor = foundTensor;
+			inputTensor = TensorData::adopt(PI::DataType_Float32, requiredShape, foundTensor);
 			return true;
 		}
 
@@ -243,27 +246,70 @@ bool buildComputeInputs(
 }
 
 void fillInputs(
-	std::map<PI::TensorId, std::shared_ptr<const float>> &inputs,
-	std::unique_ptr<std::vector<std::shared_ptr<const float>>> &tensorData)
+	std::map<PI::TensorId, TensorData> &inputs,
+	std::unique_ptr<std::vector<TensorData>> &tensorData)
 {
-	for (auto it : inputs)
+	for (auto &it : inputs)
 		(*tensorData)[it.first] = it.second;
-		
 }
 
 bool compute(
 	const PI::Model *model,
-	std::unique_ptr<std::vector<std::shared_ptr<const float>>> &tensorData,
+	std::unique_ptr<std::vector<TensorData>> &tensorData,
 	std::function<void(PI::TensorId)> cbTensorComputed,
-	std::function<void(const std::string&)> cbWarningMessage)
+	std::function<void(const std::string&)> cbWarningMessage,
+	std::function<void(PI::TensorId)> cbTensorConsumed,
+	TensorAllocator *allocator,
+	const std::vector<PI::TensorId> &targets)
 {
+	/// find operators that need to run
+
+	std::vector<bool> requiredOperators;
+	if (!targets.empty())
+		requiredOperators = findRequiredOperators(model, targets, [&tensorData](PI::TensorId tensorId) {
+			return (bool)(*tensorData)[tensorId];
+		});
+	auto isOperatorRequired = [&requiredOperators](PI::OperatorId oid) {
+		return requiredOperators.empty() || requiredOperators[oid];
+	};
+
+	/// find the last operator that uses every intermediate tensor
+
+	std::vector<int> tensorLastUse;
+	if (cbTensorConsumed) {
+		tensorLastUse.resize(model->numTensors(), -1);
+		for (PI::OperatorId oid = 0, oide = (PI::OperatorId)model->numOperators(); oid<oide; oid++) {
+			if (!isOperatorRequired(oid))
+				continue;
+			std::vector<PI::TensorId> inputs, outputs;
+			model->getOperatorIo(oid, inputs, outputs);
+			for (auto tid : inputs)
+				tensorLastUse[tid] = oid;
+		}
+		for (auto tid : model->getInputs())
+			tensorLastUse[tid] = -1; // model inputs are owned by the caller
+		for (auto tid : model->getOutputs())
+			tensorLastUse[tid] = -1; // model outputs are always kept
+		for (auto tid : targets)
+			tensorLastUse[tid] = -1; // targets are what the caller wants to see
+	}
+
 	/// compute operators
 
 	for (PI::OperatorId oid = 0, oide = (PI::OperatorId)model->numOperators(); oid<oide; oid++) {
+		// skip operators that don't contribute to targets
+		if (!isOperatorRequired(oid))
+			continue;
+
 		// get operator's inputs/outputs
 		std::vector<PI::TensorId> inputs, outputs;
 		model->getOperatorIo(oid, inputs, outputs);
 
+		// inputs could have been compacted by the previous computation when this one recomputes released tensors
+		for (auto tid : inputs)
+			if (auto &data = (*tensorData)[tid]; data && data.getDataType() != PI::DataType_Float32)
+				data = data.toFloat32();
+
 		// get operator options from the model
 		std::unique_ptr<PI::OperatorOptionsList> opts(model->getOperatorOptions(oid));
 
@@ -293,16 +339,16 @@ bool compute(
 			UNUSED(outputShape)
 
 			// create output data
-			std::unique_ptr<float> outputData(new float[inputShapeSize]);
+			auto outputData = TensorData::allocate(PI::DataType_Float32, model->getTensorShape(outputs[0]), allocator);
 
 			// compute
 			auto input = (*tensorData)[inputs[0]].get();
-			auto output = outputData.get();
+			auto output = outputData.mutableData<float>();
 			for (auto inpute = input+inputShapeSize; input<inpute; input++, output++)
 				*output = fn(*input);
 
 			// save the data
-			(*tensorData)[outputs[0]].reset(outputData.release());
+			(*tensorData)[outputs[0]] = std::move(outputData);
 
 			// notify the caller
 			cbTensorComputed(outputs[0]);
@@ -400,7 +446,7 @@ bool compute(
 			assert(Tensor::flatSize(model->getTensorShape(outputs[0])) == 1);
 
 			// create output data
-			std::unique_ptr<float> outputData(new float[1]); // always return one number
+			auto outputData = TensorData::allocate(PI::DataType_Float32, model->getTensorShape(outputs[0]), allocator); // always return one number
 
 			// compute
 			auto input = (*tensorData)[inputs[0]].get();
@@ -412,10 +458,10 @@ bool compute(
 					v0 = v;
 				}
 			}
-			outputData.get()[0] = idx;
+			outputData.mutableData<float>()[0] = idx;
 
 			// save the data
-			(*tensorData)[outputs[0]].reset(outputData.release());
+			(*tensorData)[outputs[0]] = std::move(outputData);
 
 			// notify the caller
 			cbTensorComputed(outputs[0]);
@@ -464,14 +510,14 @@ bool compute(
 			auto outputShapeSize = Tensor::flatSize(outputShape);
 
 			// create output data
-			std::unique_ptr<float> outputData(new float[outputShapeSize]);
+			auto outputData = TensorData::allocate(PI::DataType_Float32, model->getTensorShape(outputs[0]), allocator);
 
 			// compute
 			NnOperators::Conv2D(
 				inputShape, (*tensorData)[inputs[0]].get(), // input
 				filterShape, model->getTensorDataF32(inputs[1]), // filter - assume that it is always a static tensor
 				model->getTensorShape(inputs[2]), model->getTensorDataF32(inputs[2]), // bias - assume that it is always a static tensor
-				outputShape, outputData.get(), // output
+				outputShape, outputData.mutableData<float>(), // output
 				translatePadding(strideWidth,  dilationWidth,  WIDTH,  inputShape, filterShape, outputShape),
 				translatePadding(strideHeight, dilationHeight, HEIGHT, inputShape, filterShape, outputShape),
 				strideWidth, strideHeight,
@@ -479,10 +525,10 @@ bool compute(
 			);
 
 			// activation function
-			applyActivationFunction(outputShapeSize, outputData.get(), activationFunction);
+			applyActivationFunction(outputShapeSize, outputData.mutableData<float>(), activationFunction);
 
 			// save the data
-			(*tensorData)[outputs[0]].reset(outputData.release());
+			(*tensorData)[outputs[0]] = std::move(outputData);
 
 			// notify the caller
 			cbTensorComputed(outputs[0]);
@@ -531,14 +577,14 @@ bool compute(
 			auto outputShapeSize = Tensor::flatSize(outputShape);
 
 			// create output data
-			std::unique_ptr<float> outputData(new float[outputShapeSize]);
+			auto outputData = TensorData::allocate(PI::DataType_Float32, model->getTensorShape(outputs[0]), allocator);
 
 			// compute
 			NnOperators::DepthwiseConv2D(
 				inputShape, (*tensorData)[inputs[0]].get(), // input
 				filterShape, model->getTensorDataF32(inputs[1]), // filter
 				model->getTensorShape(inputs[2]), model->getTensorDataF32(inputs[2]), // bias
-				outputShape, outputData.get(), // output
+				outputShape, outputData.mutableData<float>(), // output
 				translatePadding(strideWidth,  dilationWidth,  WIDTH,  inputShape, filterShape, outputShape),
 				translatePadding(strideHeight, dilationHeight, HEIGHT, inputShape, filterShape, outputShape),
 				strideWidth, strideHeight,
@@ -547,10 +593,10 @@ bool compute(
 			);
 
 			// activation function
-			applyActivationFunction(outputShapeSize, outputData.get(), activationFunction);
+			applyActivationFunction(outputShapeSize, outputData.mutableData<float>(), activationFunction);
 
 			// save the data
-			(*tensorData)[outputs[0]].reset(outputData.release());
+			(*tensorData)[outputs[0]] = std::move(outputData);
 
 			// notify the caller
 			cbTensorComputed(outputs[0]);
@@ -571,17 +617,17 @@ bool compute(
 			auto paddings = static_cast<const std::array<int32_t,2>*>(model->getTensorData(inputs[1]));
 
 			// create output data
-			std::unique_ptr<float> outputData(new float[Tensor::flatSize(outputShape)]);
+			auto outputData = TensorData::allocate(PI::DataType_Float32, model->getTensorShape(outputs[0]), allocator);
 
 			// compute
 			NnOperators::Pad(
 				paddings,
 				inputDataShape, (*tensorData)[inputs[0]].get(), // input
-				outputShape, outputData.get() // output
+				outputShape, outputData.mutableData<float>() // output
 			);
 
 			// save the data
-			(*tensorData)[outputs[0]].reset(outputData.release());
+			(*tensorData)[outputs[0]] = std::move(outputData);
 
 			// notify the caller
 			cbTensorComputed(outputs[0]);
@@ -625,21 +671,21 @@ bool compute(
 			auto outputShapeSize = Tensor::flatSize(outputShape);
 
 			// create output data
-			std::unique_ptr<float> outputData(new float[outputShapeSize]);
+			auto outputData = TensorData::allocate(PI::DataType_Float32, model->getTensorShape(outputs[0]), allocator);
 
 			// compute
 			NnOperators::FullyConnected(
 				inputShape, (*tensorData)[inputs[0]].get(), // input
 				filterShape, model->getTensorDataF32(inputs[1]), // filter
 				model->getTensorShape(inputs[2]), model->getTensorDataF32(inputs[2]), // bias
-				outputShape, outputData.get() // output
+				outputShape, outputData.mutableData<float>() // output
 			);
 
 			// activation function
-			applyActivationFunction(outputShapeSize, outputData.get(), activationFunction);
+			applyActivationFunction(outputShapeSize, outputData.mutableData<float>(), activationFunction);
 
 			// save the data
-			(*tensorData)[outputs[0]].reset(outputData.release());
+			(*tensorData)[outputs[0]] = std::move(outputData);
 
 			// notify the caller
 			cbTensorComputed(outputs[0]);
@@ -672,17 +718,17 @@ bool compute(
 			)
 
 			// create output data
-			std::unique_ptr<float> outputData(new float[Tensor::flatSize(model->getTensorShape(outputs[0]))]);
+			auto outputData = TensorData::allocate(PI::DataType_Float32, model->getTensorShape(outputs[0]), allocator);
 
 			// compute
 			NnOperators::LocalResponseNormalization(
 				model->getTensorShape(inputs[0]), (*tensorData)[inputs[0]].get(), // input
-				model->getTensorShape(outputs[0]), outputData.get(), // output
+				model->getTensorShape(outputs[0]), outputData.mutableData<float>(), // output
 				radius, alpha, beta, bias
 			);
 
 			// save the data
-			(*tensorData)[outputs[0]].reset(outputData.release());
+			(*tensorData)[outputs[0]] = std::move(outputData);
 
 			// notify the caller
 			cbTensorComputed(outputs[0]);
@@ -729,12 +775,12 @@ bool compute(
 			auto outputShapeSize = Tensor::flatSize(outputShape);
 
 			// create output data
-			std::unique_ptr<float> outputData(new float[outputShapeSize]);
+			auto outputData = TensorData::allocate(PI::DataType_Float32, model->getTensorShape(outputs[0]), allocator);
 
 			// compute
 			(operatorKind==PI::KindMaxPool ? NnOperators::MaxPool : NnOperators::AveragePool)(
 				inputShape, (*tensorData)[inputs[0]].get(), // input
-				outputShape, outputData.get(), // output
+				outputShape, outputData.mutableData<float>(), // output
 				translatePadding(strideWidth,  1/*dilationWidth*/,  WIDTH,  inputShape, filterShape, outputShape),
 				translatePadding(strideHeight, 1/*dilationHeight*/, HEIGHT, inputShape, filterShape, outputShape),
 				strideWidth, strideHeight,
@@ -742,10 +788,10 @@ bool compute(
 			);
 
 			// activation function
-			applyActivationFunction(outputShapeSize, outputData.get(), activationFunction);
+			applyActivationFunction(outputShapeSize, outputData.mutableData<float>(), activationFunction);
 
 			// save the data
-			(*tensorData)[outputs[0]].reset(outputData.release());
+			(*tensorData)[outputs[0]] = std::move(outputData);
 
 			// notify the caller
 			cbTensorComputed(outputs[0]);
@@ -766,16 +812,16 @@ bool compute(
 			UNUSED(outputShape)
 
 			// create output data
-			std::unique_ptr<float> outputData(new float[inputShapeSize]);
+			auto outputData = TensorData::allocate(PI::DataType_Float32, model->getTensorShape(outputs[0]), allocator);
 
 			// compute
 			auto input = (*tensorData)[inputs[0]].get();
-			auto output = outputData.get();
+			auto output = outputData.mutableData<float>();
 			for (auto inpute = input+inputShapeSize; input<inpute; input++, output++)
 				*output = std::tanh(*input);
 
 			// save the data
-			(*tensorData)[outputs[0]].reset(outputData.release());
+			(*tensorData)[outputs[0]] = std::move(outputData);
 
 			// notify the caller
 			cbTensorComputed(outputs[0]);
@@ -796,16 +842,16 @@ bool compute(
 			UNUSED(outputShape)
 
 			// create output data
-			std::unique_ptr<float> outputData(new float[inputShapeSize]);
+			auto outputData = TensorData::allocate(PI::DataType_Float32, model->getTensorShape(outputs[0]), allocator);
 
 			// compute
 			auto input = (*tensorData)[inputs[0]].get();
-			auto output = outputData.get();
+			auto output = outputData.mutableData<float>();
 			for (auto inpute = input+inputShapeSize; input<inpute; input++, output++)
 				*output = 1./(1. + std::exp(*input));
 
 			// save the data
-			(*tensorData)[outputs[0]].reset(outputData.release());
+			(*tensorData)[outputs[0]] = std::move(outputData);
 
 			// notify the caller
 			cbTensorComputed(outputs[0]);
@@ -819,8 +865,8 @@ bool compute(
 
 			PRINT_OPTS("Reshape: have " << opts->size() << " options, but we ignored them for now")
 
-			// just share the data array
-			(*tensorData)[outputs[0]] = (*tensorData)[inputs[0]];
+			// the output is a view of the input data
+			(*tensorData)[outputs[0]] = (*tensorData)[inputs[0]].reshaped(model->getTensorShape(outputs[0]));
 
 			// notify the caller
 			cbTensorComputed(outputs[0]);
@@ -841,11 +887,11 @@ bool compute(
 			UNUSED(outputShape)
 
 			// create output data
-			std::unique_ptr<float> outputData(new float[inputShapeSize]);
+			auto outputData = TensorData::allocate(PI::DataType_Float32, model->getTensorShape(outputs[0]), allocator);
 
 			// compute
 			auto input = (*tensorData)[inputs[0]].get();
-			auto output = outputData.get();
+			auto output = outputData.mutableData<float>();
 			auto hardSwish = [](float x) {
 				// defined in the "Searching for MobileNet3" paper (https://arxiv.org/pdf/1905.02244.pdf)
 				// h-swish(x) = x*(ReLU6(x+3)/6)
@@ -860,7 +906,7 @@ bool compute(
 				*output = hardSwish(*input);
 
 			// save the data
-			(*tensorData)[outputs[0]].reset(outputData.release());
+			(*tensorData)[outputs[0]] = std::move(outputData);
 
 			// notify the caller
 			cbTensorComputed(outputs[0]);
@@ -896,20 +942,20 @@ bool compute(
 			auto input1ShapeSize = Tensor::flatSize(input1Shape);
 
 			// create output data
-			std::unique_ptr<float> outputData(new float[input1ShapeSize]);
+			auto outputData = TensorData::allocate(PI::DataType_Float32, model->getTensorShape(outputs[0]), allocator);
 
 			// compute
 			bool succ = operatorKind==PI::KindAdd ?
 				computeDualOperator( // KindAdd
 					(*tensorData)[inputs[0]].get(), model->getTensorShape(inputs[0]),
 					getTensorDataDynamicOrStatic(inputs[1]), model->getTensorShape(inputs[1]),
-					outputData.get(), outputShape,
+					outputData.mutableData<float>(), outputShape,
 					[](float f1, float f2) {return f1+f2;})
 				:
 				computeDualOperator( // KindMul
 					(*tensorData)[inputs[0]].get(), model->getTensorShape(inputs[0]),
 					getTensorDataDynamicOrStatic(inputs[1]), model->getTensorShape(inputs[1]),
-					outputData.get(), outputShape,
+					outputData.mutableData<float>(), outputShape,
 					[](float f1, float f2) {return f1*f2;});
 			if (!succ) {
 				cbWarningMessage(STR("Computation didn't succeed: operator #" << (oid+1) <<
@@ -918,10 +964,10 @@ bool compute(
 			}
 
 			// activation function
-			applyActivationFunction(input1ShapeSize, outputData.get(), activationFunction);
+			applyActivationFunction(input1ShapeSize, outputData.mutableData<float>(), activationFunction);
 
 			// save the data
-			(*tensorData)[outputs[0]].reset(outputData.release());
+			(*tensorData)[outputs[0]] = std::move(outputData);
 
 			// notify the caller
 			cbTensorComputed(outputs[0]);
@@ -945,17 +991,17 @@ bool compute(
 			           " beta=" <<  beta)
 
 			// create output data
-			std::unique_ptr<float> outputData(new float[Tensor::flatSize(model->getTensorShape(outputs[0]))]);
+			auto outputData = TensorData::allocate(PI::DataType_Float32, model->getTensorShape(outputs[0]), allocator);
 
 			// compute
 			NnOperators::Softmax(
 				model->getTensorShape(inputs[0]), (*tensorData)[inputs[0]].get(), // input
-				model->getTensorShape(outputs[0]), outputData.get(), // output
+				model->getTensorShape(outputs[0]), outputData.mutableData<float>(), // output
 				beta
 			);
 
 			// save the data
-			(*tensorData)[outputs[0]].reset(outputData.release());
+			(*tensorData)[outputs[0]] = std::move(outputData);
 
 			// notify the caller
 			cbTensorComputed(outputs[0]);
@@ -991,10 +1037,10 @@ bool compute(
 			auto outputShapeSize = Tensor::flatSize(outputShape);
 
 			// create output data
-			std::unique_ptr<float> outputData(new float[outputShapeSize]);
+			auto outputData = TensorData::allocate(PI::DataType_Float32, model->getTensorShape(outputs[0]), allocator);
 
 			// compute
-			for (auto out = outputData.get(), oute = out+outputShapeSize; out<oute; )
+			for (auto out = outputData.mutableData<float>(), oute = out+outputShapeSize; out<oute; )
 				for (auto &in : ins) {
 					auto &inBuf = std::get<0>(in);
 					auto sz = std::get<1>(in);
@@ -1004,10 +1050,10 @@ bool compute(
 				}
 
 			// activation function
-			applyActivationFunction(outputShapeSize, outputData.get(), activationFunction);
+			applyActivationFunction(outputShapeSize, outputData.mutableData<float>(), activationFunction);
 
 			// save the data
-			(*tensorData)[outputs[0]].reset(outputData.release());
+			(*tensorData)[outputs[0]] = std::move(outputData);
 
 			// notify the caller
 			cbTensorComputed(outputs[0]);
@@ -1024,17 +1070,17 @@ bool compute(
 			auto outputShapeSize = Tensor::flatSize(outputShape);
 
 			// create output data
-			std::unique_ptr<float> outputData(new float[outputShapeSize]);
+			auto outputData = TensorData::allocate(PI::DataType_Float32, model->getTensorShape(outputs[0]), allocator);
 
 			// compute
 			NnOperators::Mean(
 				model->getTensorShape(inputs[0]), (*tensorData)[inputs[0]].get(), // input
-				outputShape, outputData.get(), // output
+				outputShape, outputData.mutableData<float>(), // output
 				static_cast<const int32_t*>(model->getTensorData(inputs[1])), Tensor::flatSize(model->getTensorShape(inputs[1]))
 			);
 
 			// save the data
-			(*tensorData)[outputs[0]].reset(outputData.release());
+			(*tensorData)[outputs[0]] = std::move(outputData);
 
 			// notify the caller
 			cbTensorComputed(outputs[0]);
@@ -1063,13 +1109,13 @@ bool compute(
 			auto input1ShapeSize = Tensor::flatSize(input1Shape);
 
 			// create output data
-			std::unique_ptr<float> outputData(new float[input1ShapeSize]);
+			auto outputData = TensorData::allocate(PI::DataType_Float32, model->getTensorShape(outputs[0]), allocator);
 
 			// compute
 			if (!computeDualOperator(
 					(*tensorData)[inputs[0]].get(), model->getTensorShape(inputs[0]),
 					getTensorDataDynamicOrStatic(inputs[1]), model->getTensorShape(inputs[1]),
-					outputData.get(), outputShape,
+					outputData.mutableData<float>(), outputShape,
 					[](float f1, float f2) {return (f1-f2)*(f1-f2);}))
 			{
 				cbWarningMessage(STR("Computation didn't succeed: operator #" << (oid+1) <<
@@ -1078,7 +1124,7 @@ bool compute(
 			}
 
 			// save the data
-			(*tensorData)[outputs[0]].reset(outputData.release());
+			(*tensorData)[outputs[0]] = std::move(outputData);
 
 			// notify the caller
 			cbTensorComputed(outputs[0]);
@@ -1102,17 +1148,17 @@ bool compute(
 			           " alignCorners=" << alignCorners)
 
 			// create output data
-			std::unique_ptr<float> outputData(new float[Tensor::flatSize(model->getTensorShape(outputs[0]))]);
+			auto outputData = TensorData::allocate(PI::DataType_Float32, model->getTensorShape(outputs[0]), allocator);
 
 			// compute
 			NnOperators::ResizeBilinear(
 				model->getTensorShape(inputs[0]), (*tensorData)[inputs[0]].get(), // input
-				model->getTensorShape(outputs[0]), outputData.get(), // output
+				model->getTensorShape(outputs[0]), outputData.mutableData<float>(), // output
 				alignCorners
 			);
 
 			// save the data
-			(*tensorData)[outputs[0]].reset(outputData.release());
+			(*tensorData)[outputs[0]] = std::move(outputData);
 
 			// notify the caller
 			cbTensorComputed(outputs[0]);
@@ -1136,17 +1182,17 @@ bool compute(
 			           " alignCorners=" << alignCorners)
 
 			// create output data
-			std::unique_ptr<float> outputData(new float[Tensor::flatSize(model->getTensorShape(outputs[0]))]);
+			auto outputData = TensorData::allocate(PI::DataType_Float32, model->getTensorShape(outputs[0]), allocator);
 
 			// compute
 			NnOperators::ResizeNearestNeighbor(
 				model->getTensorShape(inputs[0]), (*tensorData)[inputs[0]].get(), // input
-				model->getTensorShape(outputs[0]), outputData.get(), // output
+				model->getTensorShape(outputs[0]), outputData.mutableData<float>(), // output
 				alignCorners
 			);
 
 			// save the data
-			(*tensorData)[outputs[0]].reset(outputData.release());
+			(*tensorData)[outputs[0]] = std::move(outputData);
 
 			// notify the caller
 			cbTensorComputed(outputs[0]);
@@ -1156,9 +1202,63 @@ bool compute(
 			cbWarningMessage(STR("Computation didn't succeed: operator #" << (oid+1) << ": " << operatorKind << " isn't yet implemented"));
 			return false; // failed to compute the model to the end
 		}}
+
+		// notify the caller about intermediate tensors that aren't needed any more
+		if (cbTensorConsumed)
+			for (auto tid : inputs)
+				if (tensorLastUse[tid] == (int)oid && (*tensorData)[tid]) {
+					tensorLastUse[tid] = -1; // the same tensor can be used twice by one operator
+					cbTensorConsumed(tid);
+				}
 	}
 
 	return true; // successfully computed the model to the end
 }
 
+std::vector<bool> findRequiredOperators(const PI::Model *model, const std::vector<PI::TensorId> &targets, std::function<bool(PI::TensorId)> isAvailable) {
+	// which operator produces every tensor
+	std::vector<int> tensorProducer(model->numTensors(), -1);
+	for (PI::OperatorId oid = 0, oide = (PI::OperatorId)model->numOperators(); oid<oide; oid++) {
+		std::vector<PI::TensorId> inputs, outputs;
+		model->getOperatorIo(oid, inputs, outputs);
+		for (auto tid : outputs)
+			tensorProducer[tid] = oid;
+	}
+
+	// walk backwards from targets
+	std::vector<bool> required(model->numOperators(), false);
+	std::vector<PI::TensorId> tensorsToVisit = targets;
+	while (!tensorsToVisit.empty()) {
+		auto tid = tensorsToVisit.back();
+		tensorsToVisit.pop_back();
+		if (isAvailable && isAvailable(tid))
+			continue; // no need to compute it again
+		auto oid = tensorProducer[tid];
+		if (oid == -1 || required[oid])
+			continue; // model input, static tensor, or an already visited operator
+		required[oid] = true;
+		std::vector<PI::TensorId> inputs, outputs;
+		model->getOperatorIo(oid, inputs, outputs);
+		tensorsToVisit.insert(tensorsToVisit.end(), inputs.begin(), inputs.end());
+	}
+
+	return required;
+}
+
+std::vector<bool> chooseCheckpoints(const PI::Model *model) {
+	// outputs of every sqrt(N)-th operator: this keeps sqrt(N) tensors, and any other tensor needs at most sqrt(N) operators to be recomputed
+	std::vector<bool> checkpoints(model->numTensors(), false);
+	unsigned numOperators = model->numOperators();
+	unsigned interval = std::max(1u, (unsigned)std::ceil(std::sqrt((float)numOperators)));
+	for (PI::OperatorId oid = interval-1; oid < numOperators; oid += interval) {
+		std::vector<PI::TensorId> inputs, outputs;
+		model->getOperatorIo(oid, inputs, outputs);
+		for (auto tid : outputs)
+			checkpoints[tid] = true;
+	}
+	for (auto tid : model->getOutputs())
+		checkpoints[tid] = true;
+	return checkpoints;
+}
+
 }
@@ -4,6 +4,7 @@
 
 #include "plugin-interface.h"
 #include "tensor.h"
+#include "tensor-data.h"
 
 #include <string>
 #include <vector>
@@ -20,21 +21,28 @@ bool buildComputeInputs(
 	std::array<unsigned,4> imageRegion,
 	std::tuple<InputNormalizationRange,InputNormalizationColorOrder> inputNormalization,
 	std::shared_ptr<float> &inputTensor, const TensorShape &inputShape,
-	std::map<PluginInterface::TensorId, std::shared_ptr<const float>> &inputs, // output the set of inputs
+	std::map<PluginInterface::TensorId, TensorData> &inputs, // output the set of inputs
 	std::function<void(PluginInterface::TensorId)> cbTensorComputed,
 	std::function<void(const std::string&)> cbWarningMessage
 );
 
 void fillInputs(
-	std::map<PluginInterface::TensorId, std::shared_ptr<const float>> &inputs,
-	std::unique_ptr<std::vector<std::shared_ptr<const float>>> &tensorData
+	std::map<PluginInterface::TensorId, TensorData> &inputs,
+	std::unique_ptr<std::vector<TensorData>> &tensorData
 );
 
 bool compute(
 	const PluginInterface::Model *model,
-	std::unique_ptr<std::vector<std::shared_ptr<const float>>> &tensorData,
+	std::unique_ptr<std::vector<TensorData>> &tensorData,
 	std::function<void(PluginInterface::TensorId)> cbTensorComputed,
-	std::function<void(const std::string&)> cbWarningMessage
+	std::function<void(const std::string&)> cbWarningMessage,
+	std::function<void(PluginInterface::TensorId)> cbTensorConsumed = nullptr, // called when no remaining operator needs an intermediate tensor, the caller can compact or release it
+	TensorAllocator *allocator = nullptr, // output tensors are allocated here, the heap is used by default
+	const std::vector<PluginInterface::TensorId> &targets = {} // only operators needed to compute these tensors are run, tensors already present in tensorData aren't recomputed, all operators are run when empty
 );
 
+std::vector<bool> findRequiredOperators(const PluginInterface::Model *model, const std::vector<PluginInterface::TensorId> &targets, // operators that the targets depend on
+	std::function<bool(PluginInterface::TensorId)> isAvailable = nullptr); // the walk stops at available tensors
+std::vector<bool> chooseCheckpoints(const PluginInterface::Model *model); // tensors to always keep so that any other tensor can be recomputed from nearby ones
+
 }
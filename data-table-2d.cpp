@@ -4,6 +4,7 @@
 #include "tensor.h"
 #include "misc.h"
 #include "util.h"
+#include "parallel.h"
 
 #include <QFontMetrics>
 #include <QImage>
@@ -11,9 +12,13 @@
 #include <QSettings>
 
 #include <cmath>
+#include <cstring>
 #include <functional>
+#include <limits>
+#include <mutex>
 #include <sstream>
 #include <tuple>
+#include <type_traits>
 
 #include <assert.h>
 #include <half.hpp> // to instantiate DataTable2D with the float16 type
@@ -40,16 +45,110 @@ DataTable2DBase::DataTable2DBase(QWidget *parent)
 DataTable2DBase::~DataTable2DBase()
 { }
 
+DataTable2DBase* DataTable2DBase::create(const TensorData &tensor, QWidget *parent) {
+	switch (tensor.getDataType()) {
+	case PluginInterface::DataType_Float16:
+		return new DataTable2D<half_float::half>(tensor.contiguous(), parent);
+	case PluginInterface::DataType_BFloat16: // there's no native bfloat16 type, show it as float32
+		return new DataTable2D<float>(tensor.toFloat32(), parent);
+	case PluginInterface::DataType_Float32:
+		return new DataTable2D<float>(tensor.contiguous(), parent);
+	case PluginInterface::DataType_Float64:
+		return new DataTable2D<double>(tensor.contiguous(), parent);
+	case PluginInterface::DataType_Int8:
+		return new DataTable2D<int8_t>(tensor.contiguous(), parent);
+	case PluginInterface::DataType_UInt8:
+		return new DataTable2D<uint8_t>(tensor.contiguous(), parent);
+	case PluginInterface::DataType_Int16:
+		return new DataTable2D<int16_t>(tensor.contiguous(), parent);
+	case PluginInterface::DataType_Int32:
+		return new DataTable2D<int32_t>(tensor.contiguous(), parent);
+	case PluginInterface::DataType_Int64:
+		return new DataTable2D<int64_t>(tensor.contiguous(), parent);
+	}
+	FAIL("unsupported tensor data type " << tensor.getDataType())
+}
+
+/// local helpers
+
+static const size_t minMaxMinChunk = 0x40000; // elements per thread, smaller arrays are scanned by one thread
+
+template<typename T>
+static void combineMinMax(std::tuple<T,T> &mm, const std::tuple<T,T> &other) {
+	if (std::get<0>(other) < std::get<0>(mm))
+		std::get<0>(mm) = std::get<0>(other);
+	if (std::get<1>(other) > std::get<1>(mm))
+		std::get<1>(mm) = std::get<1>(other);
+}
+
+// min/max of an array: chunks are scanned by separate threads with the loop that the compiler vectorizes
+template<typename T>
+static std::tuple<T,T> arrayMinMax(const T *data, size_t len) {
+	std::tuple<T,T> result(std::numeric_limits<T>::max(), std::numeric_limits<T>::lowest());
+	std::mutex resultLock;
+	Parallel::forRange(len, minMaxMinChunk, [&](size_t b, size_t e) {
+		auto mm = Util::arrayMinMax(data + b, e - b);
+		std::unique_lock<std::mutex> l(resultLock);
+		combineMinMax(result, mm);
+	});
+	return result;
+}
+
+// min/max of a 2D strided array: rows are split between threads
+template<typename T>
+static std::tuple<T,T> stridedMinMax(const T *data, unsigned nrows, unsigned ncols, size_t strideRow, size_t strideCol) {
+	if (strideCol == 1 && (strideRow == ncols || nrows == 1))
+		return arrayMinMax(data, size_t(nrows)*ncols); // contiguous slice
+	std::tuple<T,T> result(std::numeric_limits<T>::max(), std::numeric_limits<T>::lowest());
+	std::mutex resultLock;
+	Parallel::forRange(nrows, std::max<size_t>(1, minMaxMinChunk/std::max(1u, ncols)), [&](size_t rb, size_t re) {
+		std::tuple<T,T> mm(std::numeric_limits<T>::max(), std::numeric_limits<T>::lowest());
+		for (size_t r = rb; r < re; r++) {
+			const T *row = data + r*strideRow;
+			if (strideCol == 1)
+				combineMinMax(mm, Util::arrayMinMax(row, ncols));
+			else
+				for (unsigned c = 0; c < ncols; c++, row += strideCol) {
+					if (*row < std::get<0>(mm))
+						std::get<0>(mm) = *row;
+					if (*row > std::get<1>(mm))
+						std::get<1>(mm) = *row;
+				}
+		}
+		std::unique_lock<std::mutex> l(resultLock);
+		combineMinMax(result, mm);
+	});
+	return result;
+}
+
+// identifies the data contents: images of the data are cached under it
+// the storage doesn't change while the table keeps it alive unless the table is notified with dataChanged, which starts the new generation
+static unsigned dataGeneration = 0; // only used on the GUI thread
+
+static std::string dataKey(const TensorData &tensor) {
+	return STR(tensor.storageId() << ':' << tensor.rawData() << ':' << dataGeneration);
+}
+
 /// local helper classes
 
+// DataSource is a 2D slice of the tensor: element (r,c) is at data[base + r*strideRow + c*strideCol]
 template<typename T>
 class DataSource {
-	unsigned numRows;
-	unsigned numColumns;
+	unsigned                                 numRows;
+	unsigned                                 numColumns;
+	const T*                                &data; // shares data pointer with the DataTable2D instance
+	size_t                                   base;
+	size_t                                   strideRow;
+	size_t                                   strideCol;
+	mutable std::unique_ptr<std::tuple<T,T>> minMaxCache; // computed on first use
 public:
-	DataSource(unsigned numRows_, unsigned numColumns_)
+	DataSource(unsigned numRows_, unsigned numColumns_, const T *&data_, size_t base_, size_t strideRow_, size_t strideCol_)
 	: numRows(numRows_)
 	, numColumns(numColumns_)
+	, data(data_)
+	, base(base_)
+	, strideRow(strideRow_)
+	, strideCol(strideCol_)
 	{
 	}
 	virtual ~DataSource() { }
@@ -61,55 +160,51 @@ public: // iface: data access
 	unsigned ncols() const {
 		return numColumns;
 	}
-	virtual T value(unsigned r, unsigned c) const = 0;
+	T value(unsigned r, unsigned c) const {
+		return data[base + r*strideRow + c*strideCol];
+	}
+	const T* rowData(unsigned r) const { // elements of the row are columnStride() apart
+		return data + base + r*strideRow;
+	}
+	size_t rowStride() const {
+		return strideRow;
+	}
+	size_t columnStride() const {
+		return strideCol;
+	}
+	void dataChanged() const { // the values changed, the shape stays the same
+		minMaxCache.reset();
+	}
 
 public: // iface: data computations
 	std::tuple<T,T> computeMinMax() const {
-		T dmin = std::numeric_limits<T>::max();
-		T dmax = std::numeric_limits<T>::lowest();
-		for (unsigned r = 0, re = nrows(); r < re; r++)
-			for (unsigned c = 0, ce = ncols(); c < ce; c++) {
-				auto d = value(r,c);
-				if (d < dmin)
-					dmin = d;
-				if (d > dmax)
-					dmax = d;
-			}
-		return std::tuple<T,T>(dmin, dmax);
+		if (!minMaxCache)
+			minMaxCache.reset(new std::tuple<T,T>(stridedMinMax(data + base, numRows, numColumns, strideRow, strideCol)));
+		return *minMaxCache;
 	}
 };
 
 template<typename T>
 class TensorSliceDataSource : public DataSource<T> {
-	const TensorShape               shape;
-	const T*                       &data; // shares data pointer with the DataTable2D instance
-	unsigned                        idxVertical;
-	unsigned                        idxHorizontal;
-	mutable std::vector<unsigned>   fixedIdxs;
-
 public:
-	TensorSliceDataSource(const TensorShape &shape_, unsigned idxVertical_, unsigned idxHorizontal_, const std::vector<unsigned> &fixedIdxs_, const T *&data_)
-	: DataSource<T>(shape_[idxVertical_], shape_[idxHorizontal_])
-	, shape(shape_)
-	, data(data_)
-	, idxVertical(idxVertical_)
-	, idxHorizontal(idxHorizontal_)
-	, fixedIdxs(fixedIdxs_)
+	TensorSliceDataSource(const TensorShape &shape, unsigned idxVertical, unsigned idxHorizontal, const std::vector<unsigned> &fixedIdxs, const T *&data)
+	: DataSource<T>(shape[idxVertical], shape[idxHorizontal], data, offset(fixedIdxs, idxVertical, idxHorizontal, shape), stride(shape, idxVertical), stride(shape, idxHorizontal))
 	{
 	}
 
-	T value(unsigned r, unsigned c) const override {
-		fixedIdxs[idxVertical] = r;
-		fixedIdxs[idxHorizontal] = c;
-		return data[offset(fixedIdxs, shape)];
-	}
-
 private:
-	static unsigned offset(std::vector<unsigned> &idxs, const TensorShape &shape) {
-		unsigned off = 0;
+	static size_t stride(const TensorShape &shape, unsigned idx) {
+		size_t s = 1;
+		for (unsigned i = idx+1, ie = shape.size(); i < ie; i++)
+			s *= shape[i];
+		return s;
+	}
+	static size_t offset(const std::vector<unsigned> &idxs, unsigned idxVertical, unsigned idxHorizontal, const TensorShape &shape) {
+		size_t off = 0;
 		for (unsigned i = 0, ie = shape.size(); i < ie; i++) {
 			off *= shape[i];
-			off += idxs[i];
+			if (i != idxVertical && i != idxHorizontal)
+				off += idxs[i];
 		}
 		return off;
 	}
@@ -127,10 +222,13 @@ enum ColorSchemaEnum {
 	COLORSCHEME_GRAYSCALE_MIDDLE_DOWN
 };
 
+static const unsigned colorLutSize = 4096; // colors are looked up by the normalized value quantized to this many levels
+
 class BaseColorSchema {
 public:
 	virtual ~BaseColorSchema() { }
 	virtual QColor color(float value) const = 0;
+	virtual void colorize(const float *values, size_t valuesRowStride, unsigned numRows, unsigned numColumns, unsigned scaleFactor, QImage &image) const = 0; // paints values into the RGB32 image, each value as a scaleFactor x scaleFactor square
 };
 
 template<class ColorMapper, class ValueMapper>
@@ -147,7 +245,30 @@ public:
 
 public:
 	QColor color(float value) const override {
-		return ColorMapper::mapColor(ValueMapper::mapValue(value, minValue, maxValue));
+		return QColor(ColorMapper::lut()[lutIndex(ValueMapper::mapValue(value, minValue, maxValue))]);
+	}
+	void colorize(const float *values, size_t valuesRowStride, unsigned numRows, unsigned numColumns, unsigned scaleFactor, QImage &image) const override {
+		auto lut = ColorMapper::lut();
+		for (unsigned r = 0; r < numRows; r++, values += valuesRowStride) {
+			auto *line = reinterpret_cast<QRgb*>(image.scanLine(r*scaleFactor));
+			if (scaleFactor == 1)
+				for (unsigned c = 0; c < numColumns; c++)
+					line[c] = lut[lutIndex(ValueMapper::mapValue(values[c], minValue, maxValue))];
+			else
+				for (unsigned c = 0; c < numColumns; c++) {
+					auto color = lut[lutIndex(ValueMapper::mapValue(values[c], minValue, maxValue))];
+					for (unsigned rptCol = 0; rptCol < scaleFactor; rptCol++)
+						*line++ = color;
+				}
+			for (unsigned rptRow = 1; rptRow < scaleFactor; rptRow++)
+				std::memcpy(image.scanLine(r*scaleFactor+rptRow), image.scanLine(r*scaleFactor), image.bytesPerLine());
+		}
+	}
+
+private:
+	static unsigned lutIndex(float value) { // value is normally 0..1, values outside are clamped and NaNs are mapped to 0
+		value = value*(colorLutSize-1) + 0.5f;
+		return value >= 0 ? (value < colorLutSize ? unsigned(value) : colorLutSize-1) : 0;
 	}
 };
 
@@ -174,13 +295,22 @@ public:
 template<uint8_t Clr1R, uint8_t Clr1G, uint8_t Clr1B, uint8_t Clr2R, uint8_t Clr2G, uint8_t Clr2B>
 class ColorMapper {
 public:
-	static QColor mapColor(float value) {
-		return QColor(
+	static QRgb mapColor(float value) {
+		return qRgb(
 			float(Clr1R)+value*(Clr2R-Clr1R),
 			float(Clr1G)+value*(Clr2G-Clr1G),
 			float(Clr1B)+value*(Clr2B-Clr1B)
 		);
 	}
+	static const QRgb* lut() { // colors for the values 0..1 quantized to colorLutSize levels, computed once
+		static const std::vector<QRgb> colors = []() {
+			std::vector<QRgb> colors(colorLutSize);
+			for (unsigned i = 0; i < colorLutSize; i++)
+				colors[i] = mapColor(float(i)/(colorLutSize-1));
+			return colors;
+		}();
+		return colors.data();
+	}
 };
 
 class TextColorForBackground {
@@ -274,10 +404,11 @@ public: // custom interface
 /// DataTable2D
 
 template<typename T>
-DataTable2D<T>::DataTable2D(const TensorShape &shape_, const T *data_, QWidget *parent)
+DataTable2D<T>::DataTable2D(const TensorData &tensor_, QWidget *parent)
 : DataTable2DBase(parent)
-, shape(shape_)
-, data(data_)
+, shape(tensor_.getShape())
+, tensor(tensor_)
+, data(tensor.template data<T>())
 , dimVertical(0)
 , dimHorizontal(0)
 , self(false)
@@ -303,6 +434,7 @@ DataTable2D<T>::DataTable2D(const TensorShape &shape_, const T *data_, QWidget *
 ,     imageViewInitialized(false)
 {
 	assert(shape.size() > 1); // otherwise DataTable1D should be used
+	assert(tensor.isContiguous());
 
 	layout.addWidget(&headerWidget);
 	  headerLayout.addWidget(&shapeLabel);
@@ -451,8 +583,9 @@ DataTable2D<T>::DataTable2D(const TensorShape &shape_, const T *data_, QWidget *
 	headerLayout.setContentsMargins(0,0,0,0); // XXX this doesn't work for some reason: widget still has vertical margins
 	header1Layout.setContentsMargins(0,0,0,0);
 
-	// data range
-	auto dataRange = Util::arrayMinMax(data, Tensor::flatSize(shape));
+	// data range and identity
+	auto dataRange = arrayMinMax(data, Tensor::flatSize(shape));
+	imageKey = dataKey(tensor);
 	dataRangeLabel.setText(QString(tr("Data Range: %1..%2")).arg(std::get<0>(dataRange)).arg(std::get<1>(dataRange)));
 
 	// create the model
@@ -491,6 +624,8 @@ DataTable2D<T>::DataTable2D(const TensorShape &shape_, const T *data_, QWidget *
 			std::get<0>(dataRange),
 			std::get<1>(dataRange)
 		));
+		if (imageViewInitialized) // images are colored with the same schema
+			updateBwImageView(false/*initialUpdate*/);
 	});
 	connect(&scaleBwImageSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), [this](int i) {
 		if (self)
@@ -517,23 +652,26 @@ DataTable2D<T>::DataTable2D(const TensorShape &shape_, const T *data_, QWidget *
 /// interface
 
 template<typename T>
-void DataTable2D<T>::dataChanged(const void *data) {
-	dataChangedTyped(static_cast<const T*>(data));
-}
-
-/// internals
-
-template<typename T>
-void DataTable2D<T>::dataChangedTyped(const T *data_) {
+bool DataTable2D<T>::dataChanged(const TensorData &tensor_) {
+	if (tensor_.getDataType() != tensor.getDataType())
+		return false;
+	assert(tensor_.getShape() == shape);
 	// update the numeric table
 	(static_cast<DataModel<T>*>(tableModel.get()))->beginResetModel();
-	data = data_;
+	tensor = tensor_.contiguous();
+	data = tensor.template data<T>();
+	dataGeneration++; // the storage might be the same while the values are new
+	imageKey = dataKey(tensor);
+	(static_cast<DataModel<T>*>(tableModel.get()))->getDataSource()->dataChanged();
 	(static_cast<DataModel<T>*>(tableModel.get()))->endResetModel();
 	// update XRay-style view if it is enabled
 	if (viewDataAsBwImageCheckBox.isChecked())
 		updateBwImageView(false/*initialUpdate*/);
+	return true;
 }
 
+/// internals
+
 template<typename T>
 std::vector<unsigned> DataTable2D<T>::mkIdxs() const {
 	std::vector<unsigned> idxs;
@@ -551,29 +689,50 @@ std::vector<unsigned> DataTable2D<T>::mkIdxs() const {
 template<typename T>
 void DataTable2D<T>::updateBwImageView(bool initialUpdate) {
 	// helpers
-	auto dataSourceToBwImage = [](const DataSource<T> *dataSource, unsigned scaleFactor, std::tuple<T,T> &minMax) {
-		std::unique_ptr<uchar> data(new uchar[dataSource->ncols()*dataSource->nrows()*scaleFactor*scaleFactor]);
+	auto dataSourceToBwImage = [](const DataSource<T> *dataSource, unsigned scaleFactor, ColorSchemaEnum colorSchemaEnum, std::tuple<T,T> &minMax) {
 		minMax = dataSource->computeMinMax();
+		unsigned numRows = dataSource->nrows(), numColumns = dataSource->ncols();
+		if (colorSchemaEnum != COLORSCHEME_NONE) { // the color schema paints all rows straight into the image memory
+			std::unique_ptr<const BaseColorSchema> colorSchema(createColorSchema(colorSchemaEnum, std::get<0>(minMax), std::get<1>(minMax)));
+			QImage image(numColumns*scaleFactor, numRows*scaleFactor, QImage::Format_RGB32);
+			if constexpr (std::is_same<T,float>::value)
+				if (dataSource->columnStride() == 1) { // float rows are colorized in place
+					colorSchema->colorize(dataSource->rowData(0), dataSource->rowStride(), numRows, numColumns, scaleFactor, image);
+					return image;
+				}
+			std::vector<float> values(size_t(numRows)*numColumns);
+			auto stride = dataSource->columnStride();
+			for (unsigned r = 0; r < numRows; r++) {
+				auto *row = dataSource->rowData(r);
+				for (unsigned c = 0; c < numColumns; c++)
+					values[size_t(r)*numColumns + c] = row[c*stride];
+			}
+			colorSchema->colorize(values.data(), numColumns, numRows, numColumns, scaleFactor, image);
+			return image;
+		}
+		// grayscale: each row is written once into the image memory, and then repeated scaleFactor times
+		QImage image(numColumns*scaleFactor, numRows*scaleFactor, QImage::Format_Grayscale8);
 		auto minMaxRange = std::get<1>(minMax)-std::get<0>(minMax);
 		auto normalize = [minMax,minMaxRange](T d) {
 			return 255.*(d-std::get<0>(minMax))/minMaxRange;
 		};
-		auto *p = data.get();
-		for (unsigned r = 0, re = dataSource->nrows(); r < re; r++)
-			for (unsigned rptRow = 0; rptRow<scaleFactor; rptRow++)
-				for (unsigned c = 0, ce = dataSource->ncols(); c < ce; c++)
+		auto stride = dataSource->columnStride();
+		for (unsigned r = 0; r < numRows; r++) {
+			auto *p = image.scanLine(r*scaleFactor);
+			auto *row = dataSource->rowData(r);
+			if (stride == 1 && scaleFactor == 1) // contiguous row
+				for (unsigned c = 0; c < numColumns; c++)
+					p[c] = normalize(row[c]);
+			else
+				for (unsigned c = 0; c < numColumns; c++) {
+					uint8_t v = normalize(row[c*stride]);
 					for (unsigned rptCol = 0; rptCol<scaleFactor; rptCol++)
-						*p++ = normalize(dataSource->value(r,c));
-		auto dataPtr = data.release();
-		return std::tuple<std::unique_ptr<uchar>,QImage>(
-			std::unique_ptr<uchar>(dataPtr),
-			QImage(   dataPtr
-				, dataSource->ncols()*scaleFactor               // width
-				, dataSource->nrows()*scaleFactor               // height
-				, dataSource->ncols()*scaleFactor*sizeof(uchar) // bytesPerLine
-				, QImage::Format_Grayscale8
-			)
-		);
+						*p++ = v;
+				}
+			for (unsigned rptRow = 1; rptRow<scaleFactor; rptRow++)
+				std::memcpy(image.scanLine(r*scaleFactor+rptRow), image.scanLine(r*scaleFactor), image.bytesPerLine());
+		}
+		return image;
 	};
 
 	// list all combinations
@@ -590,13 +749,13 @@ void DataTable2D<T>::updateBwImageView(bool initialUpdate) {
 			curr.resize(curr.size()-1);
 		};
 
-		auto dims = shape;
+		std::vector<unsigned> dims(shape.begin(), shape.end());
 		dims[dimVertical] = 1; // X and Y are set to 1 - we don't need to list them because they are on X,Y axes of pictures
 		dims[dimHorizontal] = 1;
 		iterate(0, {}, dims, indexes);
 	}
 
-	auto fmtIndex = [this](const std::vector<unsigned> &index) {
+	auto fmtIndex = [dimVertical = dimVertical, dimHorizontal = dimHorizontal](const std::vector<unsigned> &index) {
 		std::ostringstream ss;
 		ss << "[";
 		unsigned n = 0;
@@ -624,21 +783,30 @@ void DataTable2D<T>::updateBwImageView(bool initialUpdate) {
 		self = false;
 	}
 
+	// images are generated by the image view on its threads when they become visible: the generator gets copies of everything it needs
 	const unsigned numColumns = 16; // TODO should be based on width()/cell.width // TODO scaling coefficient initial value should also be adaptable
-	const unsigned numRows = (indexes.size()+numColumns-1)/numColumns;
-	imageView.setSizesAndData(numColumns/*width*/, numRows/*height*/, numColumns - (numRows*numColumns - indexes.size()), [&](unsigned x, unsigned y) {
-		std::unique_ptr<DataSource<T>> dataSource(new TensorSliceDataSource<T>(shape, dimVertical, dimHorizontal, indexes[y*numColumns+x], data));
-		std::tuple<T,T> minMax;
-		auto imageWithData = dataSourceToBwImage(dataSource.get(), scaleBwImageSpinBox.value()/*scale 1+*/, minMax);
-		return ImageGridWidget::ImageData(
-			QString("%1\n%2 .. %3")
-				.arg(S2Q(fmtIndex(indexes[y*numColumns+x])))
-				.arg(std::get<0>(minMax))
-				.arg(std::get<1>(minMax)),
-			std::unique_ptr<uchar>(std::get<0>(imageWithData).release()),
-			std::get<1>(imageWithData)
-		);
-	});
+	const unsigned scaleFactor = scaleBwImageSpinBox.value(); // 1+
+	const auto colorSchemaEnum = (ColorSchemaEnum)colorSchemaComboBox.currentData().toInt();
+	imageView.setSizesAndData(
+		numColumns,
+		indexes.size(),
+		QSize(shape[dimHorizontal]*scaleFactor, shape[dimVertical]*scaleFactor),
+		2/*labelLines*/,
+		STR(imageKey << ':' << sizeof(T) << ':' << shape << ':' << dimVertical << ':' << dimHorizontal << ':' << scaleFactor << ':' << colorSchemaEnum),
+		[tensor = tensor, shape = shape, dimVertical = dimVertical, dimHorizontal = dimHorizontal, indexes, scaleFactor, colorSchemaEnum, dataSourceToBwImage, fmtIndex](unsigned idx) {
+			const T *data = tensor.template data<T>();
+			TensorSliceDataSource<T> dataSource(shape, dimVertical, dimHorizontal, indexes[idx], data);
+			std::tuple<T,T> minMax;
+			auto image = dataSourceToBwImage(&dataSource, scaleFactor, colorSchemaEnum, minMax);
+			return ImageGridWidget::ImageData(
+				QString("%1\n%2 .. %3")
+					.arg(S2Q(fmtIndex(indexes[idx])))
+					.arg(std::get<0>(minMax))
+					.arg(std::get<1>(minMax)),
+				image
+			);
+		}
+	);
 }
 
 template<typename T>
@@ -654,10 +822,10 @@ void DataTable2D<T>::setShowImageViewMode(bool showImageView) {
 			imageView.setToolTip(QString(tr("Tensor data as a B/W image normalized to the data range of currently viewed tensor slice")));
 			imageViewInitialized = true;
 		}
-		// disable all other widgets so that the data view can't be changed
-		headerWidget.setEnabled(false);
+		// disable dimension choices so that the data view can't be changed, the color schema can still be changed
+		shapeDimensionsWidget.setEnabled(false);
 	} else {
-		headerWidget.setEnabled(true);
+		shapeDimensionsWidget.setEnabled(true);
 	}
 	// visibility of scale controls
 	scaleBwImageLabel.setVisible(showImageView);
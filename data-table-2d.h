@@ -16,7 +16,9 @@
 
 #include "image-grid-widget.h"
 #include "tensor.h"
+#include "tensor-data.h"
 
+#include <string>
 #include <vector>
 #include <memory>
 
@@ -26,13 +28,16 @@ public:
 	DataTable2DBase(QWidget *parent);
 	virtual ~DataTable2DBase();
 public: // interface
-	virtual void dataChanged(const void *data) = 0; // notify the widget that the data changed (only the data itself, not the array shape)
+	virtual bool dataChanged(const TensorData &tensor) = 0; // notify the widget that the data changed (only the data itself, not the array shape), returns false when the table has to be re-created for the new data type
+	static DataTable2DBase* create(const TensorData &tensor, QWidget *parent); // creates the table of the type matching the tensor
 };
 
 template<typename T>
 class DataTable2D : public DataTable2DBase {
 	TensorShape      shape;
+	TensorData       tensor; // keeps the data alive while it is displayed
 	const T*         data;
+	std::string      imageKey; // identifies the data contents
 	unsigned         dimVertical;
 	unsigned         dimHorizontal;
 	bool             self;   // to prevent signals from programmatically changed values
@@ -61,13 +66,12 @@ class DataTable2D : public DataTable2DBase {
 	bool                                     imageViewInitialized;
 
 public: // constructor
-	DataTable2D(const TensorShape &shape_, const T *data_, QWidget *parent);
+	DataTable2D(const TensorData &tensor_, QWidget *parent); // the tensor has to be contiguous
 
 public: // interface
-	void dataChanged(const void *data) override; // notify the widget that the data changed (only the data itself, not the array shape)
+	bool dataChanged(const TensorData &tensor_) override;
 
 private: // internals
-	void dataChangedTyped(const T *data_); // notify the widget that the data changed (only the data itself, not the array shape)
 	std::vector<unsigned> mkIdxs() const;
 	void updateBwImageView(bool initialUpdate);
 	void setShowImageViewMode(bool showImageView);
@@ -3,111 +3,203 @@
 #include "image-grid-widget.h"
 
 #include <QFontMetrics>
+#include <QPainter>
+#include <QColor>
+#include <QPaintEvent>
+#include <QMetaObject>
 
 #include <algorithm>
+#include <list>
+#include <map>
+#include <utility>
 
 #include <assert.h>
 
 #include "util.h"
+#include "parallel.h"
+
+// options
+static const size_t imageCacheBytes = 256*1024*1024; // images are evicted from the cache when it grows beyond this size
+static const size_t maxQueueSize    = 256;           // older requests are dropped, they are probably for the area that isn't visible any more
+static const QColor clrPlaceholder  = QColor(0xd0,0xd0,0xd0);
+
+/// local helpers
+
+// ImageCache keeps the recently used images of all grids
+class ImageCache {
+	typedef std::pair<std::string, unsigned> Key; // (content, index)
+	std::mutex                                                          lock;
+	size_t                                                              numBytes = 0;
+	std::list<std::pair<Key, ImageGridWidget::ImageData>>              images; // most recently used first
+	std::map<Key, std::list<std::pair<Key, ImageGridWidget::ImageData>>::iterator> index;
+
+public:
+	static ImageCache& instance() {
+		static ImageCache cache;
+		return cache;
+	}
+	bool get(const std::string &key, unsigned idx, ImageGridWidget::ImageData &imageData) {
+		std::unique_lock<std::mutex> l(lock);
+		auto it = index.find(Key(key, idx));
+		if (it == index.end())
+			return false;
+		images.splice(images.begin(), images, it->second);
+		imageData = it->second->second;
+		return true;
+	}
+	void put(const std::string &key, unsigned idx, const ImageGridWidget::ImageData &imageData) {
+		std::unique_lock<std::mutex> l(lock);
+		if (index.find(Key(key, idx)) != index.end())
+			return; // another grid generated it too
+		images.emplace_front(Key(key, idx), imageData);
+		index[Key(key, idx)] = images.begin();
+		numBytes += std::get<1>(imageData).sizeInBytes();
+		while (numBytes > imageCacheBytes && images.size() > 1) {
+			numBytes -= std::get<1>(images.back().second).sizeInBytes();
+			index.erase(images.back().first);
+			images.pop_back();
+		}
+	}
+};
 
-// NN Insight sometimes shows garbage instead of BW images due to this big: "QLabel::setPixmap fails and QLabel displays garbage", see https://bugreports.qt.io/browse/QTBUG-81516
+/// constructor
 
 ImageGridWidget::ImageGridWidget(QWidget *parent)
 : QWidget(parent)
-, layout(this)
+, numColumns(0)
+, numImages(0)
+, labelHeight(0)
+, hSpacing(Util::getScreenDPI()*horizontalSpacing)
+, stopping(false)
 {
 }
 
-void ImageGridWidget::setSizesAndData(size_t width, size_t height, size_t lastRow, std::function<ImageGridWidget::ImageData(unsigned x, unsigned y)> cbGetImage) {
-#if defined(WITH_ASSERTS)
-	unsigned imgWidth = 0;
-#endif
-	unsigned imgHeight = 0;
-
-	std::unique_ptr<QFontMetrics> labelFontMetrics;
-
-	imageWidgets.resize(height);
-	for (unsigned row = 0; row < height; row++) {
-		auto rowWidth = (row+1)<height ? width : lastRow;
-		imageWidgets[row].resize(rowWidth);
-		for (unsigned col = 0; col < rowWidth; col++) {
-			auto img = cbGetImage(col, row);
-			auto &imgLabelString = std::get<0>(img);
-			auto &imgImage       = std::get<2>(img);
-			if (row==0 && col==0) {
-#if defined(WITH_ASSERTS)
-				imgWidth = imgImage.width();
-#endif
-				imgHeight = imgImage.height();
-			} else { // all images are assumed to have the same size, because they are slices of the same tensor
-				assert(imgImage.width() == imgWidth);
-				assert(imgImage.height() == imgHeight);
-			}
-			auto &widgets = imageWidgets[row][col];
-			auto &labelWidget = std::get<0>(widgets);
-			auto &imageWidget = std::get<1>(widgets);
-
-			// create and set up widgets
-			labelWidget.reset(new QLabel(imgLabelString, this));
-			imageWidget.reset(new QLabel(this));
-			imageWidget.get()->setPixmap(QPixmap::fromImage(imgImage));
-			if (!labelFontMetrics)
-				labelFontMetrics.reset(new QFontMetrics(labelWidget->font()));
-
-			{ // set widths to be the same
-				auto maxWidth = std::max(labelFontMetrics->size(0/*flags*/, labelWidget->text()).width(), imgImage.width());
-				labelWidget->setMinimumWidth(maxWidth);
-				imageWidget->setMinimumWidth(maxWidth);
-			}
-
-			// set policies, widget margins, and tooltips
-			for (auto l : {&labelWidget, &imageWidget}) {
-				l->get()->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
-				l->get()->setContentsMargins(0,0,0,0);
-				l->get()->setToolTip(QString(tr("One slice of the activation layer tensor %1")).arg(imgLabelString));
-			}
-			labelWidget->setAlignment(Qt::AlignCenter|Qt::AlignBottom); // bottom - closer to the image
-			imageWidget->setAlignment(Qt::AlignCenter); // in case it is smaller than the label
-			//labelWidget->setStyleSheet("QLabel { background-color : red; color : blue; }");
+ImageGridWidget::~ImageGridWidget() {
+	{
+		std::unique_lock<std::mutex> l(lock);
+		stopping = true;
+		condition.notify_all();
+	}
+	for (auto &t : threads)
+		t.join();
+}
 
-			// add widgets to the layout
-			layout.addWidget(labelWidget.get(), 2*row+0, col);
-			layout.addWidget(imageWidget.get(), 2*row+1, col);
-		}
+/// interface
+
+void ImageGridWidget::setSizesAndData(unsigned numColumns_, unsigned numImages_, QSize imageSize_, unsigned labelLines, const std::string &cacheKey_, ImageFn imageFn_) {
+	assert(numColumns_ > 0);
+
+	{ // requests for the old content are dropped, images that are being generated for it now still go to the cache
+		std::unique_lock<std::mutex> l(lock);
+		labelHeight = QFontMetrics(font()).lineSpacing()*labelLines;
+		numColumns = numColumns_;
+		numImages  = numImages_;
+		imageSize  = imageSize_;
+		cacheKey   = cacheKey_;
+		imageFn    = imageFn_;
+		queue.clear();
+		pending.clear();
 	}
 
-	// find total label height
-	unsigned totalLabelHeight = 0;
-	for (auto &widgetRow : imageWidgets)
-		totalLabelHeight += std::get<0>(widgetRow[0])->height();
+	// set size
+	unsigned numRows = (numImages+numColumns-1)/numColumns;
+	resize(
+		std::min(numImages, numColumns)*(imageSize.width()+hSpacing) - (numImages > 0 ? hSpacing : 0),
+		numRows*(labelHeight+imageSize.height())
+	);
+	update();
+}
 
-	// find total image cell widths
-	unsigned totalImageCellWidths = 0;
-	{
-		std::vector<unsigned> maxWidths;
-		maxWidths.resize(width);
-		for (auto &widgetRow : imageWidgets) {
-			unsigned col = 0;
-			for (auto &widgetCell : widgetRow) {
-				maxWidths[col] = std::max(maxWidths[col], (unsigned)std::max(std::get<0>(widgetCell)->width(), std::get<1>(widgetCell)->width()));
-				col++;
+/// overridden
+
+void ImageGridWidget::paintEvent(QPaintEvent *event) {
+	QPainter painter(this);
+
+	// only cells in the exposed area are painted: in a scroll area it is the visible part of the widget
+	auto rect = event->rect();
+	unsigned cellWidth = imageSize.width()+hSpacing, cellHeight = labelHeight+imageSize.height();
+	if (numImages == 0 || cellWidth == 0 || cellHeight == 0)
+		return;
+	unsigned col0 = std::max(0, rect.left())/cellWidth;
+	unsigned row0 = std::max(0, rect.top())/cellHeight;
+	unsigned col1 = std::min(numColumns-1, unsigned(std::max(0, rect.right()))/cellWidth);
+	unsigned row1 = std::min((numImages-1)/numColumns, unsigned(std::max(0, rect.bottom()))/cellHeight);
+
+	bool requested = false;
+	for (unsigned row = row0; row <= row1; row++)
+		for (unsigned col = col0; col <= col1; col++) {
+			unsigned idx = row*numColumns + col;
+			if (idx >= numImages)
+				break;
+			auto r = cellRect(idx);
+			ImageData imageData;
+			if (ImageCache::instance().get(cacheKey, idx, imageData)) {
+				painter.drawText(QRect(r.topLeft(), QSize(r.width(), labelHeight)), Qt::AlignCenter|Qt::AlignBottom, std::get<0>(imageData)); // bottom - closer to the image
+				painter.drawImage(r.topLeft() + QPoint(0, labelHeight), std::get<1>(imageData));
+				continue;
+			}
+
+			// not generated yet: a placeholder is painted until it is
+			painter.fillRect(QRect(r.topLeft() + QPoint(0, labelHeight), imageSize), clrPlaceholder);
+			std::unique_lock<std::mutex> l(lock);
+			if (pending.find(idx) == pending.end()) {
+				queue.push_front(idx);
+				pending.insert(idx);
+				if (queue.size() > maxQueueSize) {
+					pending.erase(queue.back());
+					queue.pop_back();
+				}
+				requested = true;
 			}
 		}
-		for (auto w : maxWidths)
-			totalImageCellWidths += w;
+	if (requested) {
+		if (threads.empty()) // threads are started on the first request: many grids are created and destroyed without ever generating anything
+			for (unsigned t = 0, te = std::max(1u, Parallel::numThreads()/2); t < te; t++)
+				threads.emplace_back(&ImageGridWidget::loop, this);
+		condition.notify_all();
 	}
+}
 
-	// set spacing
-	unsigned hSpacing = Util::getScreenDPI()*horizontalSpacing;
-	layout.setHorizontalSpacing(hSpacing);
-	layout.setVerticalSpacing  (0); // the layout has no spacing, instead spacing is provided by the spacing widgets
-
-	// TODO add margins?
-	layout.setContentsMargins(0,0,0,0);
+/// internals
 
-	// set size
-	resize(
-		totalImageCellWidths + hSpacing*(width-1),
-		totalLabelHeight + imgHeight*height
+QRect ImageGridWidget::cellRect(unsigned index) const { // sizes are only changed on the GUI thread under the lock
+	return QRect(
+		(index%numColumns)*(imageSize.width()+hSpacing),
+		(index/numColumns)*(labelHeight+imageSize.height()),
+		imageSize.width(),
+		labelHeight+imageSize.height()
 	);
 }
+
+void ImageGridWidget::loop() {
+	while (true) {
+		// take the newest request
+		unsigned idx;
+		std::string key;
+		ImageFn fn;
+		{
+			std::unique_lock<std::mutex> l(lock);
+			condition.wait(l, [this]() {return stopping || !queue.empty();});
+			if (stopping)
+				return;
+			idx = queue.front();
+			queue.pop_front();
+			key = cacheKey;
+			fn = imageFn;
+		}
+
+		// generate
+		ImageCache::instance().put(key, idx, fn(idx));
+
+		// paint it if it is still the current content
+		QRect rect;
+		{
+			std::unique_lock<std::mutex> l(lock);
+			if (key != cacheKey)
+				continue;
+			pending.erase(idx);
+			rect = cellRect(idx);
+		}
+		QMetaObject::invokeMethod(this, [this,rect]() {update(rect);}, Qt::QueuedConnection);
+	}
+}
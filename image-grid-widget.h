@@ -3,32 +3,62 @@
 #pragma once
 
 #include <QWidget>
-#include <QGridLayout>
 #include <QImage>
-#include <QLabel>
 #include <QString>
+#include <QSize>
+#include <QRect>
+class QPaintEvent;
 
+#include <deque>
 #include <functional>
-#include <memory>
+#include <set>
+#include <string>
 #include <tuple>
 #include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
+// ImageGridWidget paints a grid of labeled images of the same size:
+// only images in the visible part of the grid are generated, on the widget's own threads,
+// and generated images are kept in the cache that all grids share, so that they survive re-creation of the grid
 class ImageGridWidget : public QWidget {
 	Q_OBJECT
 
 // parameters
 	const float       horizontalSpacing  = 0.1; // in inches
 
-// fields
-	QGridLayout       layout;
-	std::vector<std::vector<std::tuple<std::unique_ptr<QLabel>,std::unique_ptr<QLabel>>>> imageWidgets; // by row, by col: {label, image}
-
 public: // types
-	typedef std::tuple<QString,std::unique_ptr<uchar>,QImage> ImageData;
+	typedef std::tuple<QString,QImage> ImageData; // label and image, the image has to own its data
+	typedef std::function<ImageData(unsigned index)> ImageFn; // called on the generating threads
+
+private: // fields
+	unsigned                  numColumns;
+	unsigned                  numImages;
+	QSize                     imageSize;
+	unsigned                  labelHeight;
+	unsigned                  hSpacing;
+	std::string               cacheKey;   // identifies the content, images are cached under (cacheKey, index)
+	// generating threads
+	std::vector<std::thread>  threads;    // started when the first image is requested
+	std::mutex                lock;
+	std::condition_variable   condition;
+	bool                      stopping;
+	ImageFn                   imageFn;
+	std::deque<unsigned>      queue;      // image indexes, newest first
+	std::set<unsigned>        pending;    // queued or being generated
 
 public: // constructor
 	ImageGridWidget(QWidget *parent);
+	~ImageGridWidget();
 
 public: // interface
-	void setSizesAndData(size_t width, size_t height, size_t lastRow, std::function<ImageData(unsigned x, unsigned y)> cbGetImage);
+	void setSizesAndData(unsigned numColumns_, unsigned numImages_, QSize imageSize_, unsigned labelLines, const std::string &cacheKey_, ImageFn imageFn_);
+
+protected: // overridden
+	void paintEvent(QPaintEvent *event) override;
+
+private: // internals
+	QRect cellRect(unsigned index) const; // label and image
+	void loop();
 };
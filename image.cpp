@@ -4,6 +4,7 @@
 #include "tensor.h"
 #include "misc.h"
 #include "util.h"
+#include "parallel.h"
 
 #include <png++/png.hpp>
 #include <avir/avir.h>
@@ -14,10 +15,16 @@
 #include <string>
 #include <array>
 #include <memory>
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <tuple>
+#include <cmath>
 #include <cstring>
 #include <functional>
 
 #include <assert.h>
+#include <stdint.h>
 
 namespace Image {
 
@@ -26,7 +33,7 @@ float* readPngImageFile(const std::string &fileName, TensorShape &outShape) {
 	auto width  = image.get_width();
 	auto height = image.get_height();
 
-	std::unique_ptr<float> data(new float[width*height*3]);
+	std::unique_ptr<float[]> data(new float[width*height*3]);
 
 	float *p = data.get();
 	for (unsigned y = 0; y < height; ++y)
@@ -58,7 +65,11 @@ void writePngImageFile(const float *pixels, const TensorShape &shape, const std:
 }
 
 float* readPixmap(const QPixmap &pixmap, TensorShape &outShape, std::function<void(const std::string&)> cbWarningMessage) {
-	QImage image = pixmap.toImage();
+	return readQImage(pixmap.toImage(), outShape, cbWarningMessage);
+}
+
+float* readQImage(const QImage &imageIn, TensorShape &outShape, std::function<void(const std::string&)> cbWarningMessage) {
+	QImage image = imageIn;
 
 	// always convert image to RGB32 so we don't have to deal with any other formats
 #if QT_VERSION >= QT_VERSION_CHECK(5,13,0) // QImage::convertTo exists since Qt-5.13
@@ -72,10 +83,10 @@ float* readPixmap(const QPixmap &pixmap, TensorShape &outShape, std::function<vo
 #endif
 
 	// TODO for pixmaps with alpha-channel use QImage::Format_ARGB32 and convert alpha to white (or any other background color)
-	if (pixmap.hasAlpha())
+	if (imageIn.hasAlphaChannel())
 		WARNING("the image has alpha channel which is converted to black")
 
-	std::unique_ptr<float> data(new float[image.width()*image.height()*3]);
+	std::unique_ptr<float[]> data(new float[image.width()*image.height()*3]);
 	auto pi = image.bits();
 	auto pf = data.get();
 
@@ -91,7 +102,7 @@ float* readPixmap(const QPixmap &pixmap, TensorShape &outShape, std::function<vo
 
 float* resizeImage(const float *pixels, const TensorShape &shapeOld, const TensorShape &shapeNew) {
 	auto sz = Tensor::flatSize(shapeNew);
-	std::unique_ptr<float> pixelsNew(new float[sz]);
+	std::unique_ptr<float[]> pixelsNew(new float[sz]);
 	avir::CImageResizer<> ImageResizer(8);
 	ImageResizer.resizeImage(
 		pixels,
@@ -124,7 +135,7 @@ float* regionOfImage(const float *pixels, const TensorShape &shape, const std::a
 
 	unsigned regionWidth  = region[2]-region[0]+1;
 	unsigned regionHeight = region[3]-region[1]+1;
-	std::unique_ptr<float> result(new float[regionHeight*regionWidth*NC]);
+	std::unique_ptr<float[]> result(new float[regionHeight*regionWidth*NC]);
 
 	unsigned skip = shape[1]*NC;
 	unsigned bpl = regionWidth*NC;
@@ -136,41 +147,206 @@ float* regionOfImage(const float *pixels, const TensorShape &shape, const std::a
 	return result.release();
 }
 
+void toQImage(const float *image, const TensorShape &shape, QImage &qimage) { // ASSUME 0..255 normalization, values outside of it are clipped
+	assert(shape.size()==3 && (shape[2]==3 || shape[2]==1));
+
+	// RGB32 is the format that QPixmap uses, so that pixmaps are created from the image without the format conversion
+	if (qimage.width() != (int)shape[1] || qimage.height() != (int)shape[0] || qimage.format() != QImage::Format_RGB32)
+		qimage = QImage(shape[1], shape[0], QImage::Format_RGB32);
+
+	// rows are converted in parallel by the loop that the compiler vectorizes
+	auto clip = [](float v) -> uint32_t {
+		return std::min(std::max(0.f, v), 255.f); // NaN becomes 0
+	};
+	uchar *bits = qimage.bits(); // detaches it on this thread
+	size_t bpl = qimage.bytesPerLine();
+	unsigned width = shape[1], numChannels = shape[2];
+	Parallel::forRange(shape[0], 0x10000/width+1, [&](size_t yb, size_t ye) {
+		for (size_t y = yb; y < ye; y++) {
+			auto src = image + y*width*numChannels;
+			auto dst = reinterpret_cast<uint32_t*>(bits + y*bpl);
+			if (numChannels == 3)
+				for (unsigned x = 0; x < width; x++, src += 3)
+					dst[x] = 0xff000000 | clip(src[0])<<16 | clip(src[1])<<8 | clip(src[2]);
+			else
+				for (unsigned x = 0; x < width; x++, src++)
+					dst[x] = 0xff000000 | clip(*src)*0x010101;
+		}
+	});
+}
+
 QPixmap toQPixmap(const float *image, const TensorShape &shape) {
-	return QPixmap::fromImage(QImage(
-		std::unique_ptr<const uchar>(Util::convertArrayFloatToUInt8(image, Tensor::flatSize(shape))).get(),
-		shape[1], // width
-		shape[0], // height
-		shape[1]*shape[2], // bytesPerLine
-		QImage::Format_RGB888
-	));
+	QImage qimage;
+	toQImage(image, shape, qimage);
+	return QPixmap::fromImage(std::move(qimage));
 }
 
-template<typename T>
-static void reverseArray(const T *src, T *dst, unsigned rowSize, unsigned blockSize) {
-	dst = dst + rowSize-blockSize;
-	for (auto srce = src + rowSize; src<srce; src+=blockSize, dst-=blockSize)
-		std::memcpy(dst, src, blockSize*sizeof(T));
+// images are processed in bands of rows on all threads
+static size_t minRowsPerThread(size_t rowSize) {
+	return 0x10000/std::max<size_t>(1, rowSize) + 1;
 }
 
 void flipHorizontally(const TensorShape &shape, const float *imgSrc, float *imgDst) {
-	unsigned rowSize = shape[1]*shape[2];
-	unsigned blockSize = shape[2];
-	for (auto imgSrce = imgSrc + Tensor::flatSize(shape); imgSrc<imgSrce; imgSrc+=rowSize, imgDst+=rowSize)
-		reverseArray(imgSrc, imgDst, rowSize, blockSize);
+	transform(shape, imgSrc, imgDst, true/*flipHorizontally*/, false/*flipVertically*/, false/*makeGrayscale*/);
 }
 
 void flipVertically(const TensorShape &shape, const float *imgSrc, float *imgDst) {
-	reverseArray(imgSrc, imgDst, Tensor::flatSize(shape), shape[1]*shape[2]);
+	transform(shape, imgSrc, imgDst, false/*flipHorizontally*/, true/*flipVertically*/, false/*makeGrayscale*/);
 }
 
 void makeGrayscale(const TensorShape &shape, const float *imgSrc, float *imgDst) {
-	assert(shape[2]==3);
-	auto convertColor = [](float R, float G, float B) {
-		return (R+G+B)/3;
+	transform(shape, imgSrc, imgDst, false/*flipHorizontally*/, false/*flipVertically*/, true/*makeGrayscale*/);
+}
+
+void transform(const TensorShape &shape, const float *imgSrc, float *imgDst, bool flipHorizontally, bool flipVertically, bool makeGrayscale) {
+	assert(shape.size()==3);
+	assert(!makeGrayscale || shape[2]==3);
+	assert(imgSrc+Tensor::flatSize(shape) <= imgDst || imgDst+Tensor::flatSize(shape) <= imgSrc);
+
+	unsigned height = shape[0], width = shape[1], numChannels = shape[2];
+	size_t rowSize = size_t(width)*numChannels;
+	Parallel::forRange(height, minRowsPerThread(rowSize), [=](size_t yb, size_t ye) {
+		for (size_t y = yb; y < ye; y++) {
+			auto src = imgSrc + (flipVertically ? height-1-y : y)*rowSize;
+			auto dst = imgDst + y*rowSize;
+			if (makeGrayscale) {
+				for (unsigned x = 0; x < width; x++, dst += 3) {
+					auto s = src + (flipHorizontally ? width-1-x : x)*3;
+					dst[0] = dst[1] = dst[2] = (s[0]+s[1]+s[2])/3;
+				}
+			} else if (flipHorizontally) {
+				for (unsigned x = 0; x < width; x++, dst += numChannels)
+					std::memcpy(dst, src + (width-1-x)*numChannels, numChannels*sizeof(float));
+			} else
+				std::memcpy(dst, src, rowSize*sizeof(float));
+		}
+	});
+}
+
+bool convolve(const TensorShape &shape, const float *imgSrc, float *imgDst, const TensorShape &filterShape, const float *filter) {
+	assert(shape.size()==3);
+	assert(imgSrc != imgDst);
+
+	unsigned height = shape[0], width = shape[1], numChannels = shape[2];
+	if (filterShape.size() != 4 || filterShape[0] != numChannels || filterShape[3] != numChannels)
+		return false;
+	unsigned kh = filterShape[1], kw = filterShape[2];
+	int padY = kh/2, padX = kw/2; // like Conv2D called with the half-kernel padding
+
+	// each channel has to be only convolved with itself: kernels[(ky*kw + kx)*numChannels + c]
+	std::vector<float> kernels(kh*kw*numChannels);
+	for (unsigned o = 0; o < numChannels; o++)
+		for (unsigned k = 0; k < kh*kw; k++)
+			for (unsigned i = 0; i < numChannels; i++) {
+				float w = filter[(o*kh*kw + k)*numChannels + i];
+				if (o == i)
+					kernels[k*numChannels + o] = w;
+				else if (w != 0)
+					return false;
+			}
+
+	// rows of the image are multiplied by rows of weights: weights of channels are repeated along the row, so that the loops are contiguous
+	size_t rowSize = size_t(width)*numChannels;
+	auto weightRow = [rowSize,numChannels](const float *weights) {
+		std::vector<float> row(rowSize);
+		for (size_t j = 0; j < rowSize; j++)
+			row[j] = weights[j%numChannels];
+		return row;
+	};
+	auto isZero = [numChannels](const float *weights) {
+		return std::all_of(weights, weights+numChannels, [](float w) {return w == 0;});
+	};
+	// accumulates src shifted by dx pixels and multiplied by weights into dst
+	auto accumulate = [width,numChannels](float *dst, const float *src, const float *weights, int dx) {
+		size_t jb = size_t(std::max(0, -dx))*numChannels;
+		size_t je = size_t(std::min<int>(width, int(width)-dx))*numChannels;
+		src += dx*int(numChannels);
+		for (size_t j = jb; j < je; j++)
+			dst[j] += weights[j]*src[j];
 	};
-	for (auto imgSrce = imgSrc + Tensor::flatSize(shape); imgSrc<imgSrce; imgSrc+=3, imgDst+=3)
-		imgDst[0] = imgDst[1] = imgDst[2] = convertColor(imgSrc[0], imgSrc[1], imgSrc[2]);
+	auto clip = [rowSize](float *row) {
+		for (size_t j = 0; j < rowSize; j++)
+			row[j] = std::min(std::max(0.f, row[j]), 255.f);
+	};
+
+	// separable kernels are applied as a horizontal and a vertical 1D convolutions: kernel = column x row
+	std::vector<float> kernelColumn(kh*numChannels), kernelRow(kw*numChannels);
+	bool separable = true;
+	for (unsigned c = 0; c < numChannels && separable; c++) {
+		auto k = [&](unsigned ky, unsigned kx) {return kernels[(ky*kw + kx)*numChannels + c];};
+		unsigned py = 0, px = 0; // the largest weight
+		for (unsigned ky = 0; ky < kh; ky++)
+			for (unsigned kx = 0; kx < kw; kx++)
+				if (std::abs(k(ky,kx)) > std::abs(k(py,px)))
+					py = ky, px = kx;
+		float pivot = k(py,px);
+		for (unsigned ky = 0; ky < kh; ky++)
+			kernelColumn[ky*numChannels + c] = k(ky,px);
+		for (unsigned kx = 0; kx < kw; kx++)
+			kernelRow[kx*numChannels + c] = pivot != 0 ? k(py,kx)/pivot : 0;
+		for (unsigned ky = 0; ky < kh; ky++)
+			for (unsigned kx = 0; kx < kw; kx++)
+				if (std::abs(k(ky,kx) - kernelColumn[ky*numChannels + c]*kernelRow[kx*numChannels + c]) > 1e-6*std::abs(pivot))
+					separable = false;
+	}
+	unsigned numTaps = 0;
+	for (unsigned k = 0; k < kh*kw; k++)
+		if (!isZero(&kernels[k*numChannels]))
+			numTaps++;
+
+	if (separable && numTaps > kh+kw) {
+		// horizontal pass
+		std::unique_ptr<float[]> tmp(new float[Tensor::flatSize(shape)]);
+		std::vector<std::vector<float>> rowWeights;
+		for (unsigned kx = 0; kx < kw; kx++)
+			rowWeights.push_back(weightRow(&kernelRow[kx*numChannels]));
+		Parallel::forRange(height, minRowsPerThread(rowSize*kw), [&](size_t yb, size_t ye) {
+			for (size_t y = yb; y < ye; y++) {
+				float *dst = tmp.get() + y*rowSize;
+				std::fill(dst, dst+rowSize, 0.f);
+				for (unsigned kx = 0; kx < kw; kx++)
+					if (!isZero(&kernelRow[kx*numChannels]))
+						accumulate(dst, imgSrc + y*rowSize, rowWeights[kx].data(), int(kx)-padX);
+			}
+		});
+		// vertical pass
+		std::vector<std::vector<float>> columnWeights;
+		for (unsigned ky = 0; ky < kh; ky++)
+			columnWeights.push_back(weightRow(&kernelColumn[ky*numChannels]));
+		Parallel::forRange(height, minRowsPerThread(rowSize*kh), [&](size_t yb, size_t ye) {
+			for (size_t y = yb; y < ye; y++) {
+				float *dst = imgDst + y*rowSize;
+				std::fill(dst, dst+rowSize, 0.f);
+				for (unsigned ky = 0; ky < kh; ky++) {
+					int sy = int(y) + int(ky) - padY;
+					if (sy >= 0 && sy < int(height) && !isZero(&kernelColumn[ky*numChannels]))
+						accumulate(dst, tmp.get() + sy*rowSize, columnWeights[ky].data(), 0);
+				}
+				clip(dst);
+			}
+		});
+	} else {
+		// 2D pass, only over non-zero weights
+		std::vector<std::tuple<int/*dy*/,int/*dx*/,std::vector<float>>> taps;
+		for (unsigned ky = 0; ky < kh; ky++)
+			for (unsigned kx = 0; kx < kw; kx++)
+				if (!isZero(&kernels[(ky*kw + kx)*numChannels]))
+					taps.push_back({int(ky)-padY, int(kx)-padX, weightRow(&kernels[(ky*kw + kx)*numChannels])});
+		Parallel::forRange(height, minRowsPerThread(rowSize*taps.size()), [&](size_t yb, size_t ye) {
+			for (size_t y = yb; y < ye; y++) {
+				float *dst = imgDst + y*rowSize;
+				std::fill(dst, dst+rowSize, 0.f);
+				for (auto &tap : taps) {
+					int sy = int(y) + std::get<0>(tap);
+					if (sy >= 0 && sy < int(height))
+						accumulate(dst, imgSrc + sy*rowSize, std::get<2>(tap).data(), std::get<1>(tap));
+				}
+				clip(dst);
+			}
+		});
+	}
+
+	return true;
 }
 
 }
@@ -16,11 +16,15 @@ namespace Image {
 float* readPngImageFile(const std::string &fileName, TensorShape &outShape);
 void writePngImageFile(const float *pixels, const TensorShape &shape, const std::string &fileName);
 float* readPixmap(const QPixmap &pixmap, TensorShape &outShape, std::function<void(const std::string&)> cbWarningMessage);
+float* readQImage(const QImage &image, TensorShape &outShape, std::function<void(const std::string&)> cbWarningMessage); // unlike pixmaps images can be read outside of the GUI thread
 float* resizeImage(const float *pixels, const TensorShape &shapeOld, const TensorShape &shapeNew);
 float* regionOfImage(const float *pixels, const TensorShape &shape, const std::array<unsigned,4> region);
+void toQImage(const float *image, const TensorShape &shape, QImage &qimage); // converts into qimage, its memory is reused when it already has the right size
 QPixmap toQPixmap(const float *image, const TensorShape &shape);
 void flipHorizontally(const TensorShape &shape, const float *imgSrc, float *imgDst);
 void flipVertically(const TensorShape &shape, const float *imgSrc, float *imgDst);
 void makeGrayscale(const TensorShape &shape, const float *imgSrc, float *imgDst);
+void transform(const TensorShape &shape, const float *imgSrc, float *imgDst, bool flipHorizontally, bool flipVertically, bool makeGrayscale); // all in one pass, images can't overlap
+bool convolve(const TensorShape &shape, const float *imgSrc, float *imgDst, const TensorShape &filterShape, const float *filter); // 'same' convolution with the Conv2D-style OHWI filter, the result is clipped to 0..255, returns false when the filter mixes channels
 
 }
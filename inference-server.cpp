@@ -0,0 +1,422 @@
+// Copyright (C) 2020 by Yuri Victorovich. All rights reserved.
+
+#include "inference-server.h"
+#include "serve-protocol.h"
+#include "compute.h"
+#include "parallel.h"
+#include "misc.h"
+
+#include <cstring>
+#include <algorithm>
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+typedef PluginInterface PI;
+
+/// local helpers
+
+static bool sendResponse(int fd, ServeProtocol::Status status, const TensorShape &shape, const void *payload, size_t payloadSize) {
+	ServeProtocol::ResponseHeader hdr = {};
+	hdr.magic = ServeProtocol::Magic;
+	hdr.status = status;
+	hdr.shape = ServeProtocol::Shape::fromTensorShape(shape);
+	hdr.payloadSize = payloadSize;
+	return ServeProtocol::writeFully(fd, &hdr, sizeof(hdr)) && ServeProtocol::writeFully(fd, payload, payloadSize);
+}
+
+static bool sendError(int fd, const std::string &msg) {
+	return sendResponse(fd, ServeProtocol::Status_Error, TensorShape(), msg.c_str(), msg.size());
+}
+
+/// constructor
+
+InferenceServer::InferenceServer(ModelRegistry &registry_, const std::vector<std::string> &modelFileNames_, Options options_)
+: registry(registry_)
+, modelFileNames(modelFileNames_)
+, options(options_)
+, tensorPool(std::make_shared<TensorPool>())
+, listenFd(-1)
+, stopping(false)
+, numRequests(0)
+, numBatches(0)
+, numErrors(0)
+{
+	assert(options.maxBatchSize > 0);
+	batchThread = std::thread(&InferenceServer::batchLoop, this);
+}
+
+InferenceServer::~InferenceServer() {
+	stop();
+	batchThread.join();
+	for (auto &t : connectionThreads)
+		t.second.join();
+	if (listenFd != -1) {
+		if (::close(listenFd) == -1)
+			PRINT_ERR("failed to close the socket '" << socketPath << "': " << strerror(errno))
+		::unlink(socketPath.c_str());
+	}
+}
+
+/// interface
+
+bool InferenceServer::listen(const std::string &socketPath_) {
+	struct sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	if (socketPath_.size() >= sizeof(addr.sun_path)) {
+		PRINT_ERR("socket path '" << socketPath_ << "' is too long")
+		return false;
+	}
+	::strcpy(addr.sun_path, socketPath_.c_str());
+
+	listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listenFd == -1) {
+		PRINT_ERR("failed to create a socket: " << strerror(errno))
+		return false;
+	}
+	::unlink(socketPath_.c_str()); // the socket file might remain from the previous run
+	if (::bind(listenFd, (struct sockaddr*)&addr, sizeof(addr)) == -1 || ::listen(listenFd, SOMAXCONN) == -1) {
+		PRINT_ERR("failed to listen on the socket '" << socketPath_ << "': " << strerror(errno))
+		::close(listenFd);
+		listenFd = -1;
+		return false;
+	}
+	socketPath = socketPath_;
+	return true;
+}
+
+void InferenceServer::run() {
+	while (!stopping) {
+		int fd = ::accept(listenFd, nullptr, nullptr);
+		if (fd == -1) {
+			if (!stopping && errno != EINTR)
+				PRINT_ERR("failed to accept a connection: " << strerror(errno))
+			continue;
+		}
+		std::unique_lock<std::mutex> l(connectionsLock);
+		// join threads of closed connections, otherwise they would accumulate in a long running server
+		for (auto id : finishedConnectionThreads) {
+			auto it = connectionThreads.find(id);
+			it->second.join();
+			connectionThreads.erase(it);
+		}
+		finishedConnectionThreads.clear();
+		// serve the new one
+		connectionFds.insert(fd);
+		std::thread t(&InferenceServer::serveConnection, this, fd);
+		auto id = t.get_id();
+		connectionThreads[id] = std::move(t);
+	}
+}
+
+void InferenceServer::stop() {
+	if (stopping.exchange(true))
+		return; // already stopping
+	// unblock accept() and reads from connections
+	if (listenFd != -1)
+		::shutdown(listenFd, SHUT_RDWR);
+	{
+		std::unique_lock<std::mutex> l(connectionsLock);
+		for (auto fd : connectionFds)
+			::shutdown(fd, SHUT_RDWR);
+	}
+	// wake up the batch loop
+	std::unique_lock<std::mutex> l(queueLock);
+	queueCondition.notify_all();
+}
+
+InferenceServer::Stats InferenceServer::getStats() const {
+	return Stats{numRequests, numBatches, numErrors};
+}
+
+/// internals
+
+std::shared_ptr<const PI::Model> InferenceServer::acquireModel(unsigned modelIndex, std::string &error) {
+	if (modelIndex >= modelFileNames.size()) {
+		error = STR("no model with the index " << modelIndex << ", the server has " << modelFileNames.size() << " models");
+		return nullptr;
+	}
+	auto model = registry.acquire(modelFileNames[modelIndex], error);
+	if (model && model->getInputs().size() != 1) {
+		error = STR("only models with a single input can be served, the model '" << modelFileNames[modelIndex] << "' has " << model->getInputs().size() << " inputs");
+		return nullptr;
+	}
+	return model;
+}
+
+void InferenceServer::serveConnection(int fd) {
+	ServeProtocol::RequestHeader hdr;
+	while (!stopping && ServeProtocol::readFully(fd, &hdr, sizeof(hdr))) {
+		if (hdr.magic != ServeProtocol::Magic) {
+			sendError(fd, "bad request header");
+			break; // the stream can't be trusted any more
+		}
+		if (hdr.kind != ServeProtocol::RequestKind_Info && hdr.kind != ServeProtocol::RequestKind_Infer && hdr.kind != ServeProtocol::RequestKind_AttachRing) {
+			sendError(fd, STR("unknown request kind " << hdr.kind));
+			break;
+		}
+
+		std::string error;
+		auto model = acquireModel(hdr.model, error);
+		if (!model) {
+			sendError(fd, error);
+			if (hdr.kind == ServeProtocol::RequestKind_Info)
+				continue;
+			break; // the payload that follows can't be consumed
+		}
+		auto inputShape = model->getTensorShape(model->getInputs()[0]);
+		auto inputSize = Tensor::flatSize(inputShape)*sizeof(float);
+
+		if (hdr.kind == ServeProtocol::RequestKind_Info) {
+			auto outputShape = ServeProtocol::Shape::fromTensorShape(model->getTensorShape(model->getOutputs()[0]));
+			if (!sendResponse(fd, ServeProtocol::Status_Ok, inputShape, &outputShape, sizeof(outputShape)))
+				break;
+			continue;
+		}
+		if (hdr.kind == ServeProtocol::RequestKind_AttachRing) {
+			model.reset(); // the ring acquires the model for every round of requests
+			serveRing(fd, hdr.model);
+			break;
+		}
+		if (Tensor::flatSize(hdr.shape.toTensorShape()) != Tensor::flatSize(inputShape) || hdr.payloadSize != inputSize) {
+			sendError(fd, STR("the input has to be float32 of the shape " << inputShape << ", got " << hdr.shape.toTensorShape() << " with " << hdr.payloadSize << " bytes"));
+			break;
+		}
+
+		// read the input
+		auto input = TensorData::allocate(PI::DataType_Float32, inputShape, tensorPool.get());
+		if (!ServeProtocol::readFully(fd, input.mutableData<float>(), inputSize))
+			break;
+
+		// queue it and wait for its batch to be computed
+		auto response = submit(model, input);
+		if (!response.valid())
+			break;
+		auto result = response.get();
+
+		// reply
+		bool sent = result.error.empty()
+			? sendResponse(fd, ServeProtocol::Status_Ok, result.output.getShape(), result.output.get(), result.output.sizeInBytes())
+			: sendError(fd, result.error);
+		if (!sent)
+			break;
+	}
+
+	std::unique_lock<std::mutex> l(connectionsLock);
+	connectionFds.erase(fd);
+	if (::close(fd) == -1)
+		PRINT_ERR("failed to close the connection: " << strerror(errno))
+	finishedConnectionThreads.push_back(std::this_thread::get_id()); // nothing else is done by this thread
+}
+
+void InferenceServer::serveRing(int fd, unsigned modelIndex) {
+	auto modelShapes = [this,modelIndex](std::shared_ptr<const PI::Model> &model, TensorShape &inputShape, size_t &inputSize, size_t &outputSize, std::string &error) {
+		model = acquireModel(modelIndex, error);
+		if (!model)
+			return false;
+		inputShape = model->getTensorShape(model->getInputs()[0]);
+		inputSize = Tensor::flatSize(inputShape)*sizeof(float);
+		outputSize = Tensor::flatSize(model->getTensorShape(model->getOutputs()[0]))*sizeof(float);
+		return true;
+	};
+	std::shared_ptr<const PI::Model> model;
+	TensorShape inputShape;
+	size_t inputSize = 0, outputSize = 0;
+	std::string error;
+	if (!modelShapes(model, inputShape, inputSize, outputSize, error)) {
+		sendError(fd, error);
+		return;
+	}
+	model.reset(); // idle rings don't keep the model loaded
+
+	// receive the ring and the eventfds
+	int fds[3];
+	if (!ServeProtocol::receiveFds(fd, fds, 3)) {
+		sendError(fd, "expected the ring memfd, the \"submitted\" eventfd and the \"completed\" eventfd");
+		return;
+	}
+	int submittedFd = fds[1], completedFd = fds[2];
+
+	// map the ring
+	struct stat st;
+	void *ring = MAP_FAILED;
+	if (::fstat(fds[0], &st) == 0 && size_t(st.st_size) >= ServeProtocol::ringHeaderSize())
+		ring = ::mmap(nullptr, st.st_size, PROT_READ|PROT_WRITE, MAP_SHARED, fds[0], 0);
+	::close(fds[0]); // the mapping keeps the memory
+	auto detach = [&]() {
+		if (ring != MAP_FAILED)
+			::munmap(ring, st.st_size);
+		::close(submittedFd);
+		::close(completedFd);
+	};
+	if (ring == MAP_FAILED) {
+		sendError(fd, "failed to map the ring");
+		detach();
+		return;
+	}
+
+	// validate the layout, the header is copied because the client can change it at any time
+	// values come from the client: checks are written so that they can't overflow
+	auto hdr = *static_cast<const ServeProtocol::RingHeader*>(ring);
+	auto isAligned = [](uint64_t off) {return off % ServeProtocol::RingAlignment == 0;};
+	if (size_t(st.st_size) < ServeProtocol::ringHeaderSize()
+		|| hdr.magic != ServeProtocol::Magic || hdr.numSlots == 0 || hdr.slotSize == 0
+		|| !isAligned(hdr.slotSize) || !isAligned(hdr.inputOffset) || !isAligned(hdr.outputOffset)
+		|| hdr.outputOffset > hdr.slotSize || hdr.outputCapacity > hdr.slotSize - hdr.outputOffset
+		|| hdr.inputOffset < sizeof(ServeProtocol::RingSlot) || hdr.inputOffset > hdr.outputOffset || inputSize > hdr.outputOffset - hdr.inputOffset
+		|| hdr.outputCapacity < outputSize
+		|| hdr.numSlots > (size_t(st.st_size) - ServeProtocol::ringHeaderSize())/hdr.slotSize)
+	{
+		sendError(fd, STR("bad ring layout, slots need " << inputSize << " input bytes and " << outputSize << " output bytes"));
+		detach();
+		return;
+	}
+	if (!sendResponse(fd, ServeProtocol::Status_Ok, inputShape, nullptr, 0)) {
+		detach();
+		return;
+	}
+
+	// serve slots until the client disconnects or the server stops
+	std::vector<std::pair<unsigned, std::future<Response>>> inFlight;
+	while (!stopping) {
+		struct pollfd pfds[2] = {{submittedFd, POLLIN, 0}, {fd, POLLIN, 0}};
+		if (::poll(pfds, 2, -1) == -1) {
+			if (errno == EINTR)
+				continue;
+			PRINT_ERR("failed to poll the ring: " << strerror(errno))
+			break;
+		}
+		if (pfds[1].revents)
+			break; // the socket is closed, or shut down by stop(): nothing else is expected from it
+		uint64_t cnt;
+		if (::read(submittedFd, &cnt, sizeof(cnt)) != sizeof(cnt))
+			continue;
+
+		// the model might have been unloaded and its file changed since the ring was attached
+		TensorShape shape;
+		size_t inSize, outSize;
+		if (modelShapes(model, shape, inSize, outSize, error) && (inSize != inputSize || outSize != outputSize)) {
+			model.reset();
+			error = "the model has changed, the ring has to be attached again";
+		}
+
+		// inputs are used in place: the slot is Busy until its output is written
+		for (unsigned s = 0; s < hdr.numSlots; s++) {
+			auto slot = ServeProtocol::ringSlot(ring, hdr, s);
+			uint32_t expected = ServeProtocol::SlotState_Submitted;
+			if (reinterpret_cast<ServeProtocol::RingSlot*>(slot)->state.compare_exchange_strong(expected, ServeProtocol::SlotState_Busy, std::memory_order_acquire)) {
+				if (model)
+					inFlight.push_back({s, submit(model, TensorData::external(PI::DataType_Float32, inputShape, slot + hdr.inputOffset))});
+				else {
+					std::promise<Response> failed;
+					failed.set_value(Response{TensorData(), error});
+					inFlight.push_back({s, failed.get_future()});
+				}
+			}
+		}
+		model.reset();
+
+		// write outputs as they are computed
+		for (auto &f : inFlight) {
+			auto slot = ServeProtocol::ringSlot(ring, hdr, f.first);
+			auto &rs = *reinterpret_cast<ServeProtocol::RingSlot*>(slot);
+			auto result = f.second.valid() ? f.second.get() : Response{TensorData(), "the server is stopping"};
+			if (result.error.empty()) {
+				rs.status = ServeProtocol::Status_Ok;
+				rs.outputShape = ServeProtocol::Shape::fromTensorShape(result.output.getShape());
+				rs.outputSize = result.output.sizeInBytes();
+				::memcpy(slot + hdr.outputOffset, result.output.get(), rs.outputSize);
+			} else {
+				rs.status = ServeProtocol::Status_Error;
+				rs.outputShape = ServeProtocol::Shape::fromTensorShape(TensorShape());
+				rs.outputSize = std::min(result.error.size(), size_t(hdr.outputCapacity));
+				::memcpy(slot + hdr.outputOffset, result.error.c_str(), rs.outputSize);
+			}
+			rs.state.store(ServeProtocol::SlotState_Done, std::memory_order_release);
+			cnt = 1;
+			if (::write(completedFd, &cnt, sizeof(cnt)) != sizeof(cnt))
+				PRINT_ERR("failed to signal the ring completion: " << strerror(errno))
+		}
+		inFlight.clear();
+	}
+
+	detach();
+}
+
+std::future<InferenceServer::Response> InferenceServer::submit(std::shared_ptr<const PI::Model> model, const TensorData &input) {
+	auto request = std::make_unique<Request>();
+	request->model = model;
+	request->input = input;
+	request->arrival = std::chrono::steady_clock::now();
+	auto response = request->response.get_future();
+
+	std::unique_lock<std::mutex> l(queueLock);
+	if (stopping)
+		return std::future<Response>(); // the batch loop wouldn't pick it up
+	queue.push_back(std::move(request));
+	queueCondition.notify_all();
+	return response;
+}
+
+void InferenceServer::batchLoop() {
+	while (true) {
+		// collect the batch
+		std::vector<std::unique_ptr<Request>> batch;
+		{
+			std::unique_lock<std::mutex> l(queueLock);
+			queueCondition.wait(l, [this]() {return stopping || !queue.empty();});
+			if (stopping)
+				break;
+			// wait for more requests until the batch is full or the oldest request reaches the deadline
+			auto deadline = queue.front()->arrival + std::chrono::microseconds(options.maxLatencyUs);
+			queueCondition.wait_until(l, deadline, [this]() {return stopping || queue.size() >= options.maxBatchSize;});
+			while (!queue.empty() && batch.size() < options.maxBatchSize) {
+				batch.push_back(std::move(queue.front()));
+				queue.pop_front();
+			}
+		}
+
+		// compute it: requests in the batch are independent, requests for the same model share it and its derived weights
+		Parallel::forRange(batch.size(), 1, [&batch,this](size_t b, size_t e) {
+			for (auto i = b; i < e; i++) {
+				batch[i]->response.set_value(infer(batch[i]->model.get(), batch[i]->input));
+				batch[i]->model.reset();
+			}
+		});
+		numRequests += batch.size();
+		numBatches++;
+	}
+
+	// fail requests that remained in the queue
+	std::unique_lock<std::mutex> l(queueLock);
+	for (auto &request : queue)
+		request->response.set_value(Response{TensorData(), "the server is stopping"});
+	queue.clear();
+}
+
+InferenceServer::Response InferenceServer::infer(const PI::Model *model, const TensorData &input) {
+	auto outputTensorId = model->getOutputs()[0];
+	std::unique_ptr<std::vector<TensorData>> tensorData(new std::vector<TensorData>(model->numTensors()));
+	(*tensorData)[model->getInputs()[0]] = input;
+
+	std::string warnings;
+	bool succ = Compute::compute(model, tensorData,
+		[](PI::TensorId) { },
+		[&warnings](const std::string &msg) {warnings += msg;},
+		[&tensorData](PI::TensorId tensorId) {(*tensorData)[tensorId].reset();}, // return intermediate buffers to the pool as soon as possible
+		tensorPool.get(),
+		{outputTensorId} // only what the output needs
+	);
+	if (!succ) {
+		numErrors++;
+		return Response{TensorData(), warnings.empty() ? std::string("computation failed") : warnings};
+	}
+	return Response{(*tensorData)[outputTensorId], ""};
+}
@@ -0,0 +1,93 @@
+// Copyright (C) 2020 by Yuri Victorovich. All rights reserved.
+
+#pragma once
+
+#include "plugin-interface.h"
+#include "tensor.h"
+#include "tensor-data.h"
+#include "tensor-pool.h"
+#include "model-registry.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <set>
+#include <map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <atomic>
+#include <chrono>
+
+// InferenceServer serves inference requests for a list of models over a Unix domain socket, or over shared memory rings attached through it:
+// concurrent requests are merged into batches that are computed together once the batch is full or its oldest request reaches the latency deadline,
+// models are loaded through the registry when requests for them arrive
+class InferenceServer {
+	typedef PluginInterface PI;
+
+public: // types
+	struct Options {
+		unsigned maxBatchSize;   // requests in one batch
+		unsigned maxLatencyUs;   // how long can the first request in a batch wait for others
+	};
+	struct Stats {
+		size_t numRequests;
+		size_t numBatches;
+		size_t numErrors;
+	};
+
+private: // types
+	struct Response {
+		TensorData  output;
+		std::string error;       // empty on success
+	};
+	struct Request {
+		std::shared_ptr<const PI::Model>      model;       // keeps the model loaded until the request is computed
+		TensorData                            input;
+		std::chrono::steady_clock::time_point arrival;
+		std::promise<Response>                response;
+	};
+
+private: // fields
+	ModelRegistry&                            registry;
+	std::vector<std::string>                  modelFileNames; // requests refer to models by their index here
+	Options                                   options;
+	std::shared_ptr<TensorPool>               tensorPool;  // buffers are recycled between requests
+	int                                       listenFd;
+	std::string                               socketPath;
+	std::atomic<bool>                         stopping;
+	// request queue
+	std::mutex                                queueLock;
+	std::condition_variable                   queueCondition;
+	std::deque<std::unique_ptr<Request>>      queue;
+	std::thread                               batchThread;
+	// connections
+	std::mutex                                connectionsLock;
+	std::set<int>                             connectionFds;
+	std::map<std::thread::id, std::thread>    connectionThreads;
+	std::vector<std::thread::id>              finishedConnectionThreads; // they are joined by run() when it accepts the next connection
+	// statistics
+	std::atomic<size_t>                       numRequests;
+	std::atomic<size_t>                       numBatches;
+	std::atomic<size_t>                       numErrors;
+
+public: // constructor
+	InferenceServer(ModelRegistry &registry_, const std::vector<std::string> &modelFileNames_, Options options_);
+	~InferenceServer();
+
+public: // interface
+	bool listen(const std::string &socketPath_); // creates the socket
+	void run(); // accepts connections until stop() is called
+	void stop();
+	Stats getStats() const;
+
+private: // internals
+	std::shared_ptr<const PI::Model> acquireModel(unsigned modelIndex, std::string &error); // served models have to have a single input
+	void serveConnection(int fd);
+	void serveRing(int fd, unsigned modelIndex); // serves the shared memory ring attached to the connection
+	std::future<Response> submit(std::shared_ptr<const PI::Model> model, const TensorData &input); // queues the request, the future is invalid when the server is stopping
+	void batchLoop();
+	Response infer(const PI::Model *model, const TensorData &input);
+};
@@ -0,0 +1,229 @@
+// Copyright (C) 2020 by Yuri Victorovich. All rights reserved.
+
+#include "layout-cache.h"
+#include "misc.h"
+#include "options.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <array>
+#include <fstream>
+#include <iomanip>
+#include <functional>
+#include <type_traits>
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace LayoutCache {
+
+static const uint32_t Magic   = 0x4c594e4e; // "NNYL"
+static const uint32_t Version = 1;           // has to be bumped when the layout changes in any way
+
+/// local helpers
+
+static std::string cacheDirectory() {
+	if (auto opt = Options::get("NN_INSIGHT_LAYOUT_CACHE")) // an empty value disables the cache
+		return opt;
+	if (auto xdg = ::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+		return STR(xdg << "/nn-insight/layouts");
+	if (auto home = ::getenv("HOME"); home && *home)
+		return STR(home << "/.cache/nn-insight/layouts");
+	return "";
+}
+
+static bool makeDirectories(const std::string &dir) {
+	for (size_t pos = dir.find('/', 1); ; pos = dir.find('/', pos+1)) {
+		auto sub = dir.substr(0, pos);
+		if (::mkdir(sub.c_str(), 0755) == -1 && errno != EEXIST) {
+			WARNING("failed to create the layout cache directory '" << sub << "': " << strerror(errno))
+			return false;
+		}
+		if (pos == std::string::npos)
+			return true;
+	}
+}
+
+static std::string fileNameForKey(const std::string &dir, const std::string &key) {
+	return STR(dir << "/" << std::hex << std::setw(16) << std::setfill('0') << std::hash<std::string>()(key) << ".layout");
+}
+
+// serialization: values are written in the native format, the files are only meant for this machine
+
+class Writer {
+	std::string &out;
+public:
+	Writer(std::string &out_) : out(out_) { }
+	template<typename T>
+	typename std::enable_if<std::is_arithmetic<T>::value>::type put(T v) {
+		out.append(reinterpret_cast<const char*>(&v), sizeof(v));
+	}
+	template<typename T, size_t N>
+	void put(const std::array<T,N> &a) {
+		for (auto &v : a)
+			put(v);
+	}
+	template<typename T>
+	void put(const std::vector<T> &v) {
+		put(uint64_t(v.size()));
+		for (auto &e : v)
+			put(e);
+	}
+	template<typename K, typename V>
+	void put(const std::map<K,V> &m) {
+		put(uint64_t(m.size()));
+		for (auto &e : m) {
+			put(e.first);
+			put(e.second);
+		}
+	}
+	void put(const std::string &s) {
+		put(uint64_t(s.size()));
+		out.append(s);
+	}
+};
+
+class Reader {
+	const std::string &in;
+	size_t pos;
+	bool ok;
+public:
+	Reader(const std::string &in_) : in(in_), pos(0), ok(true) { }
+	bool good() const {return ok;}
+	bool atEnd() const {return pos == in.size();}
+	template<typename T>
+	typename std::enable_if<std::is_arithmetic<T>::value>::type get(T &v) {
+		if (!ok || in.size()-pos < sizeof(v)) {
+			ok = false;
+			return;
+		}
+		::memcpy(&v, in.data()+pos, sizeof(v));
+		pos += sizeof(v);
+	}
+	template<typename T, size_t N>
+	void get(std::array<T,N> &a) {
+		for (auto &v : a)
+			get(v);
+	}
+	template<typename T>
+	void get(std::vector<T> &v) {
+		uint64_t size = 0;
+		get(size);
+		if (!ok || size > in.size()-pos) { // every element takes at least one byte
+			ok = false;
+			return;
+		}
+		v.resize(size);
+		for (auto &e : v)
+			get(e);
+	}
+	template<typename K, typename V>
+	void get(std::map<K,V> &m) {
+		uint64_t size = 0;
+		get(size);
+		for (uint64_t i = 0; i < size && ok; i++) {
+			K k;
+			get(k);
+			get(m[k]);
+		}
+	}
+	void get(std::string &s) {
+		uint64_t size = 0;
+		get(size);
+		if (!ok || size > in.size()-pos) {
+			ok = false;
+			return;
+		}
+		s = in.substr(pos, size);
+		pos += size;
+	}
+};
+
+/// interface
+
+bool load(const std::string &key, Layout &layout) {
+	auto dir = cacheDirectory();
+	if (dir.empty())
+		return false;
+
+	// read the file
+	std::ifstream file(fileNameForKey(dir, key), std::ios::binary);
+	if (!file.good())
+		return false;
+	std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	// parse it, the stored key has to match because the file name is only its hash
+	Reader r(data);
+	uint32_t magic = 0, version = 0;
+	std::string storedKey;
+	r.get(magic);
+	r.get(version);
+	if (!r.good() || magic != Magic || version != Version)
+		return false;
+	r.get(storedKey);
+	if (!r.good() || storedKey != key)
+		return false;
+	Layout l;
+	r.get(l.bbox);
+	r.get(l.operatorBoxes);
+	r.get(l.inputBoxes);
+	r.get(l.outputBoxes);
+	r.get(l.tensorLineCubicSplines);
+	r.get(l.tensorLabelPositions);
+	if (!r.good() || !r.atEnd()) {
+		WARNING("ignoring the broken layout cache file '" << fileNameForKey(dir, key) << "'")
+		return false;
+	}
+
+	layout = std::move(l);
+	return true;
+}
+
+void save(const std::string &key, const Layout &layout) {
+	auto dir = cacheDirectory();
+	if (dir.empty() || !makeDirectories(dir))
+		return;
+
+	// serialize
+	std::string data;
+	Writer w(data);
+	w.put(Magic);
+	w.put(Version);
+	w.put(key);
+	w.put(layout.bbox);
+	w.put(layout.operatorBoxes);
+	w.put(layout.inputBoxes);
+	w.put(layout.outputBoxes);
+	w.put(layout.tensorLineCubicSplines);
+	w.put(layout.tensorLabelPositions);
+
+	// write into a temporary file and publish it atomically: readers see either no file or the complete one
+	auto fileName = fileNameForKey(dir, key);
+	auto tmpFileName = STR(dir << "/.layout.XXXXXX");
+	int fd = ::mkstemp(&tmpFileName[0]);
+	if (fd == -1) {
+		WARNING("failed to create the layout cache file '" << tmpFileName << "': " << strerror(errno))
+		return;
+	}
+	bool ok = true;
+	for (size_t off = 0; ok && off < data.size();) {
+		auto n = ::write(fd, data.data()+off, data.size()-off);
+		if (n > 0)
+			off += n;
+		else if (n == 0 || errno != EINTR)
+			ok = false;
+	}
+	if (::close(fd) == -1)
+		ok = false;
+	if (!ok || ::rename(tmpFileName.c_str(), fileName.c_str()) == -1) {
+		WARNING("failed to write the layout cache file '" << fileName << "': " << strerror(errno))
+		::unlink(tmpFileName.c_str());
+	}
+}
+
+}
@@ -0,0 +1,30 @@
+// Copyright (C) 2020 by Yuri Victorovich. All rights reserved.
+
+#pragma once
+
+#include "model-functions.h"
+#include "plugin-interface.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <array>
+
+// LayoutCache keeps the computed graph layouts in files under the user's cache directory:
+// layouts are keyed by the description of everything that the layout depends on (topology, box sizes, labels, DPI),
+// so reopening the same model, or a model with the same structure, doesn't need to run Graphviz again
+namespace LayoutCache {
+
+struct Layout {
+	ModelFunctions::Box2                                           bbox;
+	std::vector<ModelFunctions::Box2>                              operatorBoxes;
+	std::map<PluginInterface::TensorId, ModelFunctions::Box2>      inputBoxes;
+	std::map<PluginInterface::TensorId, ModelFunctions::Box2>      outputBoxes;
+	std::vector<std::vector<std::vector<std::array<float,2>>>>     tensorLineCubicSplines;
+	std::vector<std::vector<std::array<float,2>>>                  tensorLabelPositions;
+};
+
+bool load(const std::string &key, Layout &layout); // returns false when there is no layout for the key
+void save(const std::string &key, const Layout &layout);
+
+}
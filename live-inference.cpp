@@ -0,0 +1,127 @@
+// Copyright (C) 2020 by Yuri Victorovich. All rights reserved.
+
+#include "live-inference.h"
+#include "compute.h"
+#include "image.h"
+#include "misc.h"
+
+#include <map>
+#include <array>
+
+typedef PluginInterface PI;
+
+/// constructor
+
+LiveInference::LiveInference(const PI::Model *model_, InputNormalization inputNormalization_)
+: model(model_)
+, inputNormalization(inputNormalization_)
+, tensorPool(std::make_shared<TensorPool>())
+, stopping(false)
+, stats{0, 0, 0, 0, 0}
+{
+	thread = std::thread(&LiveInference::loop, this);
+}
+
+LiveInference::~LiveInference() {
+	{
+		std::unique_lock<std::mutex> l(lock);
+		stopping = true;
+		condition.notify_all();
+	}
+	thread.join();
+}
+
+/// interface
+
+void LiveInference::submit(const QImage &frame) {
+	std::unique_lock<std::mutex> l(lock);
+	if (!pendingFrame.isNull())
+		stats.numDropped++; // the model didn't get to it
+	pendingFrame = frame;
+	pendingFrameTime = Clock::now();
+	stats.numFrames++;
+	condition.notify_all();
+}
+
+std::unique_ptr<LiveInference::Result> LiveInference::takeResult() {
+	std::unique_lock<std::mutex> l(lock);
+	return std::move(result);
+}
+
+LiveInference::Stats LiveInference::getStats() const {
+	std::unique_lock<std::mutex> l(lock);
+	return stats;
+}
+
+/// internals
+
+void LiveInference::loop() {
+	while (true) {
+		// take the pending frame
+		QImage frame;
+		Clock::time_point frameTime;
+		{
+			std::unique_lock<std::mutex> l(lock);
+			condition.wait(l, [this]() {return stopping || !pendingFrame.isNull();});
+			if (stopping)
+				return;
+			std::swap(frame, pendingFrame);
+			frameTime = pendingFrameTime;
+		}
+
+		auto r = compute(frame);
+
+		// publish the result, an untaken older result is replaced
+		auto now = Clock::now();
+		std::unique_lock<std::mutex> l(lock);
+		auto smooth = [](float &avg, float val) { // exponential moving average
+			avg = avg == 0 ? val : 0.9*avg + 0.1*val;
+		};
+		smooth(stats.latencyMs, std::chrono::duration<float, std::milli>(now - frameTime).count());
+		if (stats.numComputed > 0)
+			smooth(stats.fps, 1./std::chrono::duration<float>(now - lastResultTime).count());
+		lastResultTime = now;
+		stats.numComputed++;
+		result = std::move(r);
+	}
+}
+
+std::unique_ptr<LiveInference::Result> LiveInference::compute(const QImage &frame) {
+	std::unique_ptr<Result> r(new Result);
+	auto cbWarningMessage = [&r](const std::string &msg) {
+		r->warnings += (r->warnings.empty() ? "" : "\n") + msg;
+	};
+
+	// convert the frame
+	r->image.reset(Image::readQImage(frame, r->imageShape, cbWarningMessage), std::default_delete<float[]>());
+	if (!r->image)
+		return r;
+
+	// prepare inputs, they are resized and normalized as required by the model
+	std::map<PI::TensorId, TensorData> inputs;
+	if (!Compute::buildComputeInputs(model,
+		std::array<unsigned,4>{0,0, r->imageShape[1]-1,r->imageShape[0]-1}, inputNormalization,
+		r->image, r->imageShape,
+		inputs,
+		[](PI::TensorId) { }, cbWarningMessage))
+	{
+		if (r->warnings.empty())
+			r->warnings = "couldn't prepare arguments for the computation";
+		return r;
+	}
+	r->tensorData.reset(new std::vector<TensorData>(model->numTensors()));
+	Compute::fillInputs(inputs, r->tensorData);
+
+	// compute outputs, intermediates are returned to the pool as soon as they are consumed
+	auto &tensorData = r->tensorData;
+	if (!Compute::compute(model, tensorData,
+		[](PI::TensorId) { },
+		cbWarningMessage,
+		[&tensorData](PI::TensorId tensorId) {(*tensorData)[tensorId].reset();},
+		tensorPool.get(),
+		model->getOutputs()) && r->warnings.empty())
+	{
+		r->warnings = "computation failed";
+	}
+	return r;
+}
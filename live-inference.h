@@ -0,0 +1,68 @@
+// Copyright (C) 2020 by Yuri Victorovich. All rights reserved.
+
+#pragma once
+
+#include "plugin-interface.h"
+#include "nn-types.h"
+#include "tensor.h"
+#include "tensor-data.h"
+#include "tensor-pool.h"
+
+#include <QImage>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+// LiveInference runs the model on a stream of frames in its own thread: there is one pending frame and one frame being computed,
+// a frame that arrives while another one is pending replaces it, so that when the model falls behind stale frames are dropped
+class LiveInference {
+	typedef PluginInterface PI;
+	typedef std::chrono::steady_clock Clock;
+
+public: // types
+	struct Result {
+		std::shared_ptr<float>                   image;      // the frame as the source image
+		TensorShape                              imageShape;
+		std::unique_ptr<std::vector<TensorData>> tensorData; // only model outputs are kept
+		std::string                              warnings;   // the computation failed when not empty
+	};
+	struct Stats {
+		size_t numFrames;   // submitted
+		size_t numComputed;
+		size_t numDropped;  // replaced while pending
+		float  fps;         // computed frames per second
+		float  latencyMs;   // from submission to result
+	};
+
+private: // fields
+	const PI::Model*                  model;
+	InputNormalization                inputNormalization;
+	std::shared_ptr<TensorPool>       tensorPool;
+	std::thread                       thread;
+	mutable std::mutex                lock;
+	std::condition_variable           condition;
+	bool                              stopping;
+	QImage                            pendingFrame;
+	Clock::time_point                 pendingFrameTime;
+	std::unique_ptr<Result>           result;     // the latest result that wasn't taken yet
+	Stats                             stats;
+	Clock::time_point                 lastResultTime;
+
+public: // constructor
+	LiveInference(const PI::Model *model_, InputNormalization inputNormalization_);
+	~LiveInference(); // waits for the frame being computed
+
+public: // interface
+	void submit(const QImage &frame);
+	std::unique_ptr<Result> takeResult(); // returns nullptr when there's no new result
+	Stats getStats() const;
+
+private: // internals
+	void loop();
+	std::unique_ptr<Result> compute(const QImage &frame);
+};
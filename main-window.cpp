@@ -12,6 +12,8 @@
 #include "nn-operators.h"
 #include "image.h"
 #include "compute.h"
+#include "tensor-spill.h"
+#include "options.h"
 #include "svg-graphics-generator.h"
 #include "svg-push-button.h"
 #include "model-views/merge-dequantize-operators.h"
@@ -32,9 +34,10 @@
 #include <QScrollBar>
 #include <QSettings>
 #include <QVariant>
+#include <QScreen>
+#include <QMetaObject>
 
 #include <assert.h>
-#include <half.hpp> // to instantiate DataTable2D with the float16 type
 #include <stdlib.h> // only for ::getenv
 
 #include <map>
@@ -181,6 +184,7 @@ MainWindow::MainWindow()
 ,            computeLayout(&computeWidget)
 ,            computeButton(tr("Compute"), &computeWidget)
 ,            computeRegionComboBox(&computeWidget)
+,            computeTargetComboBox(&computeWidget)
 ,          computeByWidget(&sourceDetails)
 ,            computeByLayout(&computeByWidget)
 ,            inputNormalizationLabel(tr("Normalization"), &computeByWidget)
@@ -247,7 +251,17 @@ MainWindow::MainWindow()
 ,   memoryUseLabel(&statusBar)
 ,   memoryUseTimer(&statusBar)
 #endif
+,   tensorPoolLabel(&statusBar)
+,   memoryBudgetLabel(&statusBar)
+,   liveCaptureLabel(&statusBar)
 , plugin(nullptr)
+, liveCaptureAction(nullptr)
+, effectsGeneration(0)
+, activationStorage(Options::getChoice("NN_INSIGHT_ACTIVATION_STORAGE", {{"fp32", ActivationStorage_Float32}, {"fp16", ActivationStorage_Float16}, {"bf16", ActivationStorage_BFloat16}}, ActivationStorage_Float32))
+, memoryBudget(Options::getBytes("NN_INSIGHT_MEMORY_BUDGET", 0))
+, memoryBudgetPolicy(Options::getChoice("NN_INSIGHT_MEMORY_BUDGET_POLICY", {{"recompute", MemoryBudgetPolicy_Recompute}, {"spill", MemoryBudgetPolicy_Spill}}, MemoryBudgetPolicy_Recompute))
+, heldTensorBytes(0)
+, lastRecomputeMs(-1)
 , scaleImageWidthPct(0)
 , scaleImageHeightPct(0)
 , self(0)
@@ -294,6 +308,7 @@ MainWindow::MainWindow()
 	    sourceDetailsLayout.addWidget(&computeWidget,            6/*row*/, 0/*col*/, 1/*rowSpan*/, 4/*columnSpan*/);
 	      computeLayout.addWidget(&computeButton);
 	      computeLayout.addWidget(&computeRegionComboBox);
+	      computeLayout.addWidget(&computeTargetComboBox);
 	    sourceDetailsLayout.addWidget(&computeByWidget,          7/*row*/, 0/*col*/, 1/*rowSpan*/, 4/*columnSpan*/);
 	      computeByLayout.addWidget(&inputNormalizationLabel);
 	      computeByLayout.addWidget(&inputNormalizationRangeComboBox);
@@ -351,6 +366,9 @@ MainWindow::MainWindow()
 #if defined(USE_PERFTOOLS)
 	statusBar.addWidget(&memoryUseLabel);
 #endif
+	statusBar.addWidget(&tensorPoolLabel);
+	statusBar.addWidget(&memoryBudgetLabel);
+	statusBar.addWidget(&liveCaptureLabel);
 
 	// alignment
 	svgScrollArea.setAlignment(Qt::AlignHCenter|Qt::AlignVCenter);
@@ -397,6 +415,7 @@ MainWindow::MainWindow()
 	sourceEffectConvolutionCountComboBox.setToolTip(tr("How many times to apply the convolution"));
 	computeButton                       .setToolTip(tr("Perform neural network computation for the currently selected image as input"));
 	computeRegionComboBox               .setToolTip(tr("Choose what region of the image to compute on: the visible area or the whole image"));
+	computeTargetComboBox               .setToolTip(tr("Choose how much of the network to compute: all of it, or only operators needed for the currently selected tensor"));
 	inputNormalizationLabel             .setToolTip(tr("Specify how does this NN expect its input data be normalized"));
 	inputNormalizationRangeComboBox     .setToolTip(tr("Specify what value range does this NN expect its input data be normalized to"));
 	inputNormalizationColorOrderComboBox.setToolTip(tr("Specify what color order does this NN expect its input data be supplied in"));
@@ -453,6 +472,7 @@ MainWindow::MainWindow()
 	computeWidget                        .setSizePolicy(QSizePolicy::Minimum, QSizePolicy::Maximum);
 	computeButton                        .setSizePolicy(QSizePolicy::Minimum, QSizePolicy::Maximum);
 	computeRegionComboBox                .setSizePolicy(QSizePolicy::Fixed,   QSizePolicy::Maximum);
+	computeTargetComboBox                .setSizePolicy(QSizePolicy::Fixed,   QSizePolicy::Maximum);
 	inputNormalizationLabel              .setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Maximum); //The sizeHint() is a maximum
 	inputNormalizationRangeComboBox      .setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Maximum);
 	inputNormalizationColorOrderComboBox .setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Maximum);
@@ -509,6 +529,9 @@ MainWindow::MainWindow()
 	computeRegionComboBox.addItem("on the visible region");
 	computeRegionComboBox.addItem("on the whole image");
 
+	computeTargetComboBox.addItem("through the whole network");
+	computeTargetComboBox.addItem("up to the selected tensor");
+
 	inputNormalizationRangeComboBox.addItem("0..1",         InputNormalizationRange_0_1); // default
 	inputNormalizationRangeComboBox.addItem("0..255",       InputNormalizationRange_0_255);
 	inputNormalizationRangeComboBox.addItem("0..128",       InputNormalizationRange_0_128);
@@ -601,7 +624,7 @@ MainWindow::MainWindow()
 
 		// allocate tensors array
 		if (!tensorData) {
-			tensorData.reset(new std::vector<std::shared_ptr<const float>>);
+			tensorData.reset(new std::vector<TensorData>);
 			tensorData->resize(model->numTensors());
 		}
 
@@ -618,9 +641,12 @@ MainWindow::MainWindow()
 		auto cbWarningMessage = [this](const std::string &msg) {
 			Util::warningOk(this, S2Q(msg));
 		};
+		std::vector<PluginInterface::TensorId> targets; // empty means the whole network
+		if (computeTargetComboBox.currentIndex()==1 && nnDetailsStack.currentIndex()==2/*tensor page*/ && model->isTensorComputed(nnCurrentTensorId))
+			targets.push_back(nnCurrentTensorId);
 
 		// find input data and convert it to the required format
-		std::map<PluginInterface::TensorId, std::shared_ptr<const float>> modelInputs;
+		std::map<PluginInterface::TensorId, TensorData> modelInputs;
 		bool succ = Compute::buildComputeInputs(model.get(),
 			imageRegion, inputNormalization,
 			sourceTensorDataAsUsed, sourceTensorShape,
@@ -635,21 +661,13 @@ MainWindow::MainWindow()
 		Compute::fillInputs(modelInputs, tensorData);
 
 		// compute
-		succ = Compute::compute(model.get(), tensorData, cbTensorComputed,cbWarningMessage);
-		if (!succ) {
+		if (!runComputation(targets)) {
 			PRINT("WARNING computation didn't succeed")
 			return;
 		}
 
 		// computation succeeded
-		if (nnCurrentTensorId!=-1 && model->isTensorComputed(nnCurrentTensorId)) {
-			if (!nnTensorData2D) {
-				showNnTensorData2D();
-			} else {
-				nnTensorData2D->dataChanged((*tensorData.get())[nnCurrentTensorId].get());
-				nnTensorData2D->setEnabled(true);
-			}
-		}
+		updateNnTensorData2D();
 		updateResultInterpretation();
 		computationTimeLabel.setText(QString("Computed in %1").arg(QString("%1 ms").arg(S2Q(Util::formatUIntHumanReadable(timer.elapsed())))));
 	});
@@ -667,8 +685,21 @@ MainWindow::MainWindow()
 		updateResultInterpretation();
 	});
 	connect(&clearComputationResults, &QAbstractButton::pressed, [this]() {
+		if (liveInference) // results would be replaced right away, and the frame being computed uses the dequantized weights
+			stopLiveCapture();
 		clearComputedTensorData(Temporary);
-		removeTableIfAny();
+		removeTableIfAny(); // before the weights that it might show are released
+		size_t releasedWeightsBytes = 0, releasedBuffersBytes = 0;
+		if (auto mergeDequantize = dynamic_cast<const ModelViews::MergeDequantizeOperators*>(model.get())) // also free weights that were dequantized on demand
+			releasedWeightsBytes = mergeDequantize->releaseConvertedData();
+		if (tensorPool) // tensors are gone, return their buffers to the system
+			releasedBuffersBytes = tensorPool->trim();
+		updateTensorPoolStats();
+		if (tensorPool)
+			tensorPoolLabel.setText(QString(tr("%1, released %2 bytes of pooled buffers and %3 bytes of dequantized weights"))
+				.arg(tensorPoolLabel.text())
+				.arg(S2Q(Util::formatUIntHumanReadable(releasedBuffersBytes)))
+				.arg(S2Q(Util::formatUIntHumanReadable(releasedWeightsBytes))));
 		updateResultInterpretation();
 	});
 	connect(sourceImageScrollArea.horizontalScrollBar(), &QAbstractSlider::valueChanged, [this]() {
@@ -685,10 +716,10 @@ MainWindow::MainWindow()
 	connect(&nnTensorSaveDataButton, &QAbstractButton::pressed, [this]() {
 		PluginInterface::TensorId tensorId = nnTensorSaveDataButton.property("tensorId").toUInt();
 		PRINT("Saving data for tensor#" << tensorId)
-		if (model->getTensorHasData(tensorId) || (tensorData && (*tensorData.get())[tensorId])) {
+		if (model->getTensorHasData(tensorId) || haveComputedTensorData(tensorId)) {
 			Tensor::saveTensorDataAsJson(
 				model->getTensorShape(tensorId),
-				model->getTensorHasData(tensorId) ? model->getTensorDataF32(tensorId) : (*tensorData.get())[tensorId].get(),
+				model->getTensorHasData(tensorId) ? model->getTensorDataF32(tensorId) : getTensorData(tensorId).toFloat32().contiguous().get(),
 				CSTR("tensor#" << tensorId << ".json") // match the name with one in compute.cpp
 			);
 		} else {
@@ -706,6 +737,21 @@ MainWindow::MainWindow()
 	memoryUseTimer.start(1000);
 #endif
 
+	// reload the model when its file changes
+	modelReloadTimer.setSingleShot(true);
+	connect(&modelFileWatcher, &QFileSystemWatcher::fileChanged, [this](const QString&) {
+		modelReloadTimer.start(500/*ms*/);
+	});
+	connect(&modelReloadTimer, &QTimer::timeout, [this]() {
+		if (model)
+			reloadModelFile();
+	});
+
+	// live screen capture
+	connect(&liveCaptureTimer, &QTimer::timeout, [this]() {
+		onLiveCaptureTick();
+	});
+
 	// add menus
 	auto fileMenu = menuBar.addMenu(tr("&File"));
 	fileMenu->addAction(tr("Open Image"), [this]() {
@@ -723,6 +769,14 @@ MainWindow::MainWindow()
 	fileMenu->addAction(tr("Take Screenshot"), [this]() {
 		openImagePixmap(Util::getScreenshot(true/*hideOurWindows*/), tr("screenshot"));
 	})->setShortcut(QKeySequence(Qt::CTRL + Qt::Key_R)); // non-standard
+	liveCaptureAction = fileMenu->addAction(tr("Live Screen Capture"), [this]() {
+		if (liveInference)
+			stopLiveCapture();
+		else
+			startLiveCapture();
+	});
+	liveCaptureAction->setCheckable(true);
+	liveCaptureAction->setShortcut(QKeySequence(Qt::CTRL + Qt::Key_L)); // non-standard
 	fileMenu->addAction(tr("Paste Image"), [this]() {
 		const QClipboard *clipboard = QApplication::clipboard();
 		const QMimeData *mimeData = clipboard->mimeData();
@@ -757,7 +811,7 @@ MainWindow::MainWindow()
 		if (!fileName.isEmpty()) { // save the visible region, same as NN computation normally sees
 			std::array<unsigned,4> imageRegion = getVisibleImageRegion();
 			Image::writePngImageFile( // for simplicity - extract the region whether this is needed or not
-				std::unique_ptr<float>(Image::regionOfImage(sourceTensorDataAsUsed.get(), sourceTensorShape, imageRegion)).get(),
+				std::unique_ptr<float[]>(Image::regionOfImage(sourceTensorDataAsUsed.get(), sourceTensorShape, imageRegion)).get(),
 				{imageRegion[3]-imageRegion[1]+1, imageRegion[2]-imageRegion[0]+1, sourceTensorShape[2]},
 				Q2S(fileName.endsWith(".png") ? fileName : fileName+".png")
 			);
@@ -788,6 +842,10 @@ MainWindow::MainWindow()
 }
 
 MainWindow::~MainWindow() {
+	liveInference.reset(nullptr); // it uses the model
+	nnWidget.close(); // it refers to the model
+	if (effectsThread.joinable())
+		effectsThread.join();
 	if (model) {
 		model.reset(nullptr);
 		pluginInterface.reset(nullptr);
@@ -799,6 +857,21 @@ MainWindow::~MainWindow() {
 }
 
 bool MainWindow::loadModelFile(const QString &filePath) {
+	QString error;
+	if (!openModelFile(filePath, plugin, pluginInterface, model, error))
+		return Util::warningOk(this, error);
+	PRINT("loaded the model '" << Q2S(filePath) << "' successfully")
+
+	setupModel(filePath);
+
+	return true; // success
+}
+
+/// private methods
+
+bool MainWindow::openModelFile(const QString &filePath, const PluginManager::Plugin *&plugin, std::unique_ptr<PluginInterface> &pluginInterface,
+	std::unique_ptr<const PluginInterface::Model> &model, QString &error)
+{
 	// helpers
 	auto endsWith = [](const std::string &fullString, const std::string &ending) {
 		return
@@ -815,28 +888,46 @@ bool MainWindow::loadModelFile(const QString &filePath) {
 
 	// file name -> plugin name
 	auto pluginName = fileNameToPluginName(filePath);
-	if (pluginName == nullptr)
-		return Util::warningOk(this, QString("%1 '%2'").arg(tr("Couldn't find a plugin to open the file")).arg(filePath));
+	if (pluginName == nullptr) {
+		error = QString("%1 '%2'").arg(tr("Couldn't find a plugin to open the file")).arg(filePath);
+		return false;
+	}
 
 	// load the plugin
 	plugin = PluginManager::loadPlugin(pluginName);
-	if (!plugin)
-		FAIL(Q2S(QString("%1 '%2'").arg(tr("failed to load the plugin")).arg(pluginName)))
+	if (!plugin) {
+		error = QString("%1 '%2'").arg(tr("Failed to load the plugin")).arg(pluginName);
+		return false;
+	}
 	pluginInterface.reset(PluginManager::getInterface(plugin)());
 
 	// load the model
-	if (pluginInterface->open(Q2S(filePath)))
-		PRINT("loaded the model '" << Q2S(filePath) << "' successfully")
-	else
-		FAIL("failed to load the model '" << Q2S(filePath) << "'")
+	auto fail = [&](const QString &msg) {
+		error = msg;
+		pluginInterface.reset(nullptr);
+		PluginManager::unloadPlugin(plugin);
+		plugin = nullptr;
+		return false;
+	};
+	if (!pluginInterface->open(Q2S(filePath)))
+		return fail(QString("%1 '%2'").arg(tr("Failed to load the model")).arg(filePath));
 	if (pluginInterface->numModels() != 1)
-		FAIL("multi-model files aren't supported yet")
+		return fail(tr("Multi-model files aren't supported yet"));
 	model.reset(pluginInterface->getModel(0));
 
 	// add ModelViews::MergeDequantizeOperators
 	if (!::getenv("NN_INSIGHT_NO_MERGE_DEQUANTIZE_OPERATORS")) // XXX TODO need to have a UI-based options screen for such choices
 		model.reset(new ModelViews::MergeDequantizeOperators(model.release()));
 
+	return true;
+}
+
+void MainWindow::setupModel(const QString &filePath) {
+	// buffers of computed tensors are recycled within the model
+	tensorPool = std::make_shared<TensorPool>();
+	updateTensorPoolStats();
+	checkpointTensors = Compute::chooseCheckpoints(model.get());
+
 	// render the model as SVG image
 	nnWidget.open(model.get());
 	nnNetworkOperatorsListWidget.setNnModel(model.get());
@@ -852,11 +943,10 @@ bool MainWindow::loadModelFile(const QString &filePath) {
 	// set window title
 	setWindowTitle(QString("NN Insight: %1 (%2)").arg(filePath).arg(S2Q(Util::formatFlops(ModelFunctions::computeModelFlops(model.get())))));
 
-	return true; // success
+	// watch the file for changes
+	modelFileWatcher.addPath(filePath);
 }
 
-/// private methods
-
 bool MainWindow::haveImageOpen() const {
 	return (bool)sourceTensorDataAsLoaded;
 }
@@ -917,7 +1007,7 @@ void MainWindow::showOperatorDetails(PluginInterface::OperatorId operatorId) {
 			nnOperatorDetailsLayout.addWidget(label,         row,   3/*column*/);
 			// button
 			auto hasStaticData = model->getTensorHasData(tensorId);
-			if (hasStaticData || (tensorData && (*tensorData.get())[tensorId])) {
+			if (hasStaticData || haveComputedTensorData(tensorId)) {
 				auto button = new SvgPushButton(SvgGraphics::generateTableIcon(), &nnOperatorDetails);
 				button->setContentsMargins(0,0,0,0);
 				button->setSizePolicy(QSizePolicy::Preferred, QSizePolicy::Preferred);
@@ -1020,7 +1110,7 @@ void MainWindow::showTensorDetails(PluginInterface::TensorId tensorId, const cha
 		nnCurrentTensorId = tensorId;
 		if (nnTensorData2D)
 			clearNnTensorData2D();
-		if (model->getTensorHasData(nnCurrentTensorId) || (tensorData && (*tensorData)[nnCurrentTensorId]))
+		if (model->getTensorHasData(nnCurrentTensorId) || haveComputedTensorData(nnCurrentTensorId))
 			showNnTensorData2D();
 	}
 }
@@ -1045,7 +1135,7 @@ void MainWindow::openImageFile(const QString &imageFileName) {
 	clearComputedTensorData(Permanent); // opening image invalidates computation results
 	updateResultInterpretation();
 	// read the image as tensor
-	sourceTensorDataAsLoaded.reset(Image::readPngImageFile(Q2S(imageFileName), sourceTensorShape));
+	sourceTensorDataAsLoaded.reset(Image::readPngImageFile(Q2S(imageFileName), sourceTensorShape), std::default_delete<float[]>());
 	sourceTensorDataAsUsed = sourceTensorDataAsLoaded;
 	// enable widgets, show image
 	updateSectionWidgetsVisibility();
@@ -1069,12 +1159,12 @@ void MainWindow::openImagePixmap(const QPixmap &imagePixmap, const QString &sour
 	sourceTensorDataAsLoaded.reset(Image::readPixmap(imagePixmap, sourceTensorShape, [this,&sourceName](const std::string &msg) {
 		PRINT("WARNING: failed in " << Q2S(sourceName) << ": " << msg)
 		Util::warningOk(this, S2Q(msg));
-	}));
+	}), std::default_delete<float[]>());
 	if (!sourceTensorDataAsLoaded) // message should have been called above
 		return;
 	if (0) { // TMP: scale down a huge screenshot 1/6
 		TensorShape sourceTensorShapeNew = {sourceTensorShape[0]/6, sourceTensorShape[1]/6, sourceTensorShape[2]};
-		sourceTensorDataAsLoaded.reset(Image::resizeImage(sourceTensorDataAsLoaded.get(), sourceTensorShape, sourceTensorShapeNew));
+		sourceTensorDataAsLoaded.reset(Image::resizeImage(sourceTensorDataAsLoaded.get(), sourceTensorShape, sourceTensorShapeNew), std::default_delete<float[]>());
 		sourceTensorShape = sourceTensorShapeNew;
 	}
 	sourceTensorDataAsUsed = sourceTensorDataAsLoaded;
@@ -1097,6 +1187,9 @@ void MainWindow::clearInputImageDisplay() {
 	sourceTensorDataAsUsed = nullptr;
 	sourceTensorShape = TensorShape();
 	tensorData.reset(nullptr);
+	releasedTensors.clear();
+	spilledTensors.clear();
+	countHeldTensors();
 	scaleImageWidthPct = 0;
 	scaleImageHeightPct = 0;
 }
@@ -1110,26 +1203,60 @@ void MainWindow::clearComputedTensorData(HowLong howLong) {
 		removeTableIfAny();
 	// clear tensor data
 	tensorData.reset(nullptr);
+	releasedTensors.clear();
+	spilledTensors.clear();
+	countHeldTensors();
+	updateMemoryBudgetStats();
 }
 
 void MainWindow::effectsChanged() {
 	inputParamsChanged(); // effects change invalidates computation results
 
+	// effects are applied on the effects thread: while it is busy only the latest change is remembered
+	effectsGeneration++;
+	if (!effectsThread.joinable())
+		startApplyingEffects();
+}
+
+void MainWindow::startApplyingEffects() {
 	// all available effects that can be applied
 	bool flipHorizontally = sourceEffectFlipHorizontallyCheckBox.isChecked();
 	bool flipVertically   = sourceEffectFlipVerticallyCheckBox.isChecked();
 	bool makeGrayscale    = sourceEffectMakeGrayscaleCheckBox.isChecked();
 	auto convolution      = convolutionEffects.find((ConvolutionEffect)sourceEffectConvolutionTypeComboBox.currentData().toUInt())->second;
+	unsigned convolutionCount = sourceEffectConvolutionCountComboBox.currentData().toUInt();
 
 	// any effects to apply?
-	if (flipHorizontally || flipVertically || makeGrayscale || !std::get<1>(convolution).empty()) {
-		sourceTensorDataAsUsed.reset(applyEffects(sourceTensorDataAsLoaded.get(), sourceTensorShape,
-			flipHorizontally, flipVertically, makeGrayscale, convolution,sourceEffectConvolutionCountComboBox.currentData().toUInt()));
-	} else {
+	if (!sourceTensorDataAsLoaded || !(flipHorizontally || flipVertically || makeGrayscale || !std::get<1>(convolution).empty())) {
 		sourceTensorDataAsUsed = sourceTensorDataAsLoaded;
+		computeButton.setEnabled(true);
+		if (sourceTensorDataAsLoaded)
+			updateSourceImageOnScreen();
+		return;
 	}
 
-	updateSourceImageOnScreen();
+	// apply them in the background, the computation can't start until they are applied
+	computeButton.setEnabled(false);
+	auto generation = effectsGeneration;
+	auto image = sourceTensorDataAsLoaded;
+	auto shape = sourceTensorShape;
+	effectsThread = std::thread([this,generation,image,shape,flipHorizontally,flipVertically,makeGrayscale,convolution,convolutionCount]() {
+		std::shared_ptr<float> imageWithEffects(applyEffects(image.get(), shape,
+			flipHorizontally, flipVertically, makeGrayscale, convolution, convolutionCount),
+			std::default_delete<float[]>());
+		QMetaObject::invokeMethod(this, [this,generation,image,imageWithEffects]() {
+			effectsThread.join();
+			if (generation != effectsGeneration) {
+				startApplyingEffects(); // effects changed in the meantime
+				return;
+			}
+			computeButton.setEnabled(true);
+			if (image != sourceTensorDataAsLoaded)
+				return; // the image was replaced, ex. by a live frame: effects aren't applied to them
+			sourceTensorDataAsUsed = imageWithEffects;
+			updateSourceImageOnScreen();
+		}, Qt::QueuedConnection);
+	});
 }
 
 void MainWindow::inputNormalizationChanged() {
@@ -1145,42 +1272,33 @@ void MainWindow::inputParamsChanged() {
 
 float* MainWindow::applyEffects(const float *image, const TensorShape &shape,
 	bool flipHorizontally, bool flipVertically, bool makeGrayscale,
-	const std::tuple<TensorShape,std::vector<float>> &convolution, unsigned convolutionCount) const
+	const std::tuple<TensorShape,std::vector<float>> &convolution, unsigned convolutionCount)
 {
 	assert(shape.size()==3);
 	assert(flipHorizontally || flipVertically || makeGrayscale || !std::get<1>(convolution).empty());
 
-	unsigned idx = 0; // idx=0 is "image", idx can be 0,1,2
-	std::unique_ptr<float> withEffects[2]; // idx=1 and idx=2 are allocatable "images"
-
-	auto idxNext = [](unsigned idx) {
-		return (idx+1)<3 ? idx+1 : 1;
-	};
-	auto src = [&](unsigned idx) {
-		if (idx==0)
-			return image;
-		else
-			return (const float*)withEffects[idx-1].get();
-	};
-	auto dst = [&](unsigned idx) {
-		auto &we = withEffects[idxNext(idx)-1];
+	// effects alternate between two buffers
+	std::unique_ptr<float[]> withEffects[2];
+	unsigned idx = 0; // the buffer with the latest result
+	const float *src = image;
+	auto dst = [&]() {
+		auto &we = withEffects[src==withEffects[0].get() ? 1 : 0];
 		if (!we)
 			we.reset(new float[Tensor::flatSize(shape)]);
 		return we.get();
 	};
+	auto advance = [&](float *d) {
+		src = d;
+		idx = d==withEffects[0].get() ? 0 : 1;
+	};
 
-	if (flipHorizontally) {
-		Image::flipHorizontally(shape, src(idx), dst(idx));
-		idx = idxNext(idx);
-	}
-	if (flipVertically) {
-		Image::flipVertically(shape, src(idx), dst(idx));
-		idx = idxNext(idx);
-	}
-	if (makeGrayscale) {
-		Image::makeGrayscale(shape, src(idx), dst(idx));
-		idx = idxNext(idx);
+	// flips and grayscale are applied in one pass
+	if (flipHorizontally || flipVertically || makeGrayscale) {
+		float *d = dst();
+		Image::transform(shape, src, d, flipHorizontally, flipVertically, makeGrayscale);
+		advance(d);
 	}
+
 	if (!std::get<1>(convolution).empty()) {
 		TensorShape shapeWithBatch = shape;
 		shapeWithBatch.insert(shapeWithBatch.begin(), 1/*batch*/);
@@ -1193,22 +1311,24 @@ float* MainWindow::applyEffects(const float *image, const TensorShape &shape,
 		};
 		const static float bias[3] = {0,0,0};
 		for (unsigned i = 1; i <= convolutionCount; i++) {
-			float *d = dst(idx);
-			NnOperators::Conv2D(
-				shapeWithBatch, src(idx),
-				std::get<0>(convolution), std::get<1>(convolution).data(),
-				{3}, bias, // no bias
-				shapeWithBatch, d,
-				std::get<0>(convolution)[2]/2, std::get<0>(convolution)[1]/2, // padding, paddings not matching kernel size work but cause image shifts
-				1,1, // strides
-				1,1  // dilation factors
-			);
-			clip(d, Tensor::flatSize(shapeWithBatch)); // we have to clip the result because otherwise some values are out of range 0..255.
-			idx = idxNext(idx);
+			float *d = dst();
+			if (!Image::convolve(shape, src, d, std::get<0>(convolution), std::get<1>(convolution).data())) { // the filter mixes channels
+				NnOperators::Conv2D(
+					shapeWithBatch, src,
+					std::get<0>(convolution), std::get<1>(convolution).data(),
+					{3}, bias, // no bias
+					shapeWithBatch, d,
+					std::get<0>(convolution)[2]/2, std::get<0>(convolution)[1]/2, // padding, paddings not matching kernel size work but cause image shifts
+					1,1, // strides
+					1,1  // dilation factors
+				);
+				clip(d, Tensor::flatSize(shapeWithBatch)); // we have to clip the result because otherwise some values are out of range 0..255.
+			}
+			advance(d);
 		}
 	}
 
-	return withEffects[idx-1].release();
+	return withEffects[idx].release();
 }
 
 void MainWindow::clearEffects() {
@@ -1276,8 +1396,7 @@ void MainWindow::updateSourceImageOnScreen() {
 		scaleImageSpinBoxes.setFactor(scaleImageWidthPct);
 	}
 
-	// generate and set the pixmap
-	QPixmap pixmap;
+	// generate and set the pixmap: the float image is converted directly into the image buffer that is kept between updates
 	if (scaleImageWidthPct != 100 || scaleImageHeightPct != 100) {
 		assert(sourceTensorShape.size() == 3);
 		TensorShape resizedShape = {
@@ -1285,10 +1404,11 @@ void MainWindow::updateSourceImageOnScreen() {
 			sourceTensorShape[1]*scaleImageWidthPct/100,
 			sourceTensorShape[2]
 		};
-		std::unique_ptr<float> resizedImage(Image::resizeImage(sourceTensorDataAsUsed.get(), sourceTensorShape, resizedShape));
-		pixmap = Image::toQPixmap(resizedImage.get(), resizedShape);
+		std::unique_ptr<float[]> resizedImage(Image::resizeImage(sourceTensorDataAsUsed.get(), sourceTensorShape, resizedShape));
+		Image::toQImage(resizedImage.get(), resizedShape, sourceImageBuffer);
 	} else
-		pixmap = Image::toQPixmap(sourceTensorDataAsUsed.get(), sourceTensorShape);
+		Image::toQImage(sourceTensorDataAsUsed.get(), sourceTensorShape, sourceImageBuffer);
+	QPixmap pixmap = QPixmap::fromImage(sourceImageBuffer);
 
 	// memorize the center of sourceImage
 	bool hadPixmap = sourceImage.pixmap()!=nullptr && sourceImage.pixmap()->width()>0;
@@ -1394,8 +1514,8 @@ void MainWindow::updateResultInterpretation() {
 		sourceImageStack.addWidget(interpretationImage.get());
 
 		// resize the image
-		TensorShape resizedShape({{(unsigned)interpretationImage->height(), (unsigned)interpretationImage->width(), outputShape[2]}});
-		std::unique_ptr<float> outputResized(Image::resizeImage(output, outputShape, resizedShape));
+		TensorShape resizedShape = {(unsigned)interpretationImage->height(), (unsigned)interpretationImage->width(), outputShape[2]};
+		std::unique_ptr<float[]> outputResized(Image::resizeImage(output, outputShape, resizedShape));
 
 		// convert the output to a pixmap and set it in the widget
 		QPixmap pixmap = Image::toQPixmap(outputResized.get(), resizedShape);
@@ -1500,6 +1620,10 @@ void MainWindow::onOpenNeuralNetworkFileUserIntent() {
 }
 
 void MainWindow::closeNeuralNetwork() {
+	stopLiveCapture(); // it uses the model
+	modelReloadTimer.stop();
+	if (!modelFileWatcher.files().isEmpty())
+		modelFileWatcher.removePaths(modelFileWatcher.files());
 	clearComputedTensorData(Permanent);
 	updateResultInterpretation();
 	nnWidget.close();
@@ -1508,10 +1632,104 @@ void MainWindow::closeNeuralNetwork() {
 	PluginManager::unloadPlugin(plugin);
 	model = nullptr;
 	plugin = nullptr;
+	tensorPool = nullptr; // tensors that are still alive keep it until they are released
+	updateTensorPoolStats();
+	checkpointTensors.clear();
 	// update screen
 	updateSectionWidgetsVisibility();
 }
 
+void MainWindow::reloadModelFile() {
+	auto filePath = S2Q(pluginInterface->filePath());
+
+	// open the new version first: the current one stays when the file can't be opened, ex. when it is still being written
+	const PluginManager::Plugin *newPlugin = nullptr;
+	std::unique_ptr<PluginInterface> newPluginInterface;
+	std::unique_ptr<const PluginInterface::Model> newModel;
+	QString error;
+	if (!openModelFile(filePath, newPlugin, newPluginInterface, newModel, error)) {
+		PRINT_ERR("failed to reload the changed model file '" << Q2S(filePath) << "', keeping the loaded version: " << Q2S(error))
+		if (modelFileWatcher.files().isEmpty())
+			modelFileWatcher.addPath(filePath); // the watch is lost when the file is replaced
+		return;
+	}
+	PRINT("reloaded the changed model file '" << Q2S(filePath) << "'")
+
+	// swap
+	closeNeuralNetwork();
+	plugin = newPlugin;
+	pluginInterface = std::move(newPluginInterface);
+	model = std::move(newModel);
+	setupModel(filePath);
+	updateSectionWidgetsVisibility();
+}
+
+void MainWindow::startLiveCapture() {
+	if (!model) {
+		liveCaptureAction->setChecked(false);
+		Util::warningOk(this, tr("Open a neural network file to run it on the live screen capture"));
+		return;
+	}
+	InputNormalization inputNormalization = {
+		(InputNormalizationRange)inputNormalizationRangeComboBox.currentData().toUInt(),
+		(InputNormalizationColorOrder)inputNormalizationColorOrderComboBox.currentData().toUInt()
+	};
+	liveInference.reset(new LiveInference(model.get(), inputNormalization));
+	liveCaptureTimer.start(1000/Options::getUInt("NN_INSIGHT_LIVE_CAPTURE_FPS", 1, 1000, 10));
+	liveCaptureAction->setChecked(true);
+}
+
+void MainWindow::stopLiveCapture() {
+	liveCaptureTimer.stop();
+	liveInference.reset(nullptr); // waits for the frame being computed
+	liveCaptureLabel.setText("");
+	if (liveCaptureAction)
+		liveCaptureAction->setChecked(false);
+}
+
+void MainWindow::onLiveCaptureTick() {
+	// show the latest result
+	if (auto result = liveInference->takeResult()) {
+		if (!result->warnings.empty()) {
+			stopLiveCapture();
+			Util::warningOk(this, S2Q(result->warnings));
+			return;
+		}
+		bool newSource = !haveImageOpen() || sourceTensorShape != result->imageShape;
+		if (newSource) {
+			clearInputImageDisplay();
+			clearEffects(); // effects aren't applied to live frames
+		}
+		clearComputedTensorData(Temporary); // the table is kept, it is updated with the new data below
+		sourceTensorShape = result->imageShape;
+		sourceTensorDataAsLoaded = result->image;
+		sourceTensorDataAsUsed = result->image;
+		tensorData = std::move(result->tensorData);
+		countHeldTensors();
+		if (newSource) {
+			updateSectionWidgetsVisibility();
+			sourceImageFileNameText.setText(QString("{%1}").arg(tr("live screen capture")));
+			sourceImageFileSizeText.setText(QString("{%1}").arg(tr("live screen capture")));
+			sourceImageSizeText.setText(S2Q(STR(sourceTensorShape)));
+			updateCurrentRegionText();
+		}
+		updateSourceImageOnScreen();
+		updateNnTensorData2D();
+		updateResultInterpretation();
+	}
+
+	// capture the next frame: it replaces the pending frame if the model is still busy
+	liveInference->submit(QGuiApplication::primaryScreen()->grabWindow(0).toImage());
+
+	auto stats = liveInference->getStats();
+	liveCaptureLabel.setText(QString(tr("Live: %1 fps, latency %2 ms, %3 of %4 frames dropped"))
+		.arg(stats.fps, 0, 'f', 1)
+		.arg(stats.latencyMs, 0, 'f', 0)
+		.arg(stats.numDropped)
+		.arg(stats.numFrames)
+	);
+}
+
 QLabel* MainWindow::makeTextSelectable(QLabel *label) {
 	label->setTextInteractionFlags(Qt::TextSelectableByMouse);
 	return label;
@@ -1520,73 +1738,7 @@ QLabel* MainWindow::makeTextSelectable(QLabel *label) {
 void MainWindow::showNnTensorData2D() {
 	assert(nnCurrentTensorId >= 0);
 	if (Tensor::numMultiDims(model->getTensorShape(nnCurrentTensorId)) >= 2) {
-		switch (model->getTensorType(nnCurrentTensorId)) {
-		case PluginInterface::DataType_Float16:
-			assert(!model->isTensorComputed(nnCurrentTensorId)); // we don't yet support computed tensors of type float16 because tensorData always has float32
-			nnTensorData2D.reset(new DataTable2D<half_float::half>(
-				model->getTensorShape(nnCurrentTensorId),
-				(const half_float::half*)model->getTensorData(nnCurrentTensorId),
-				&nnTensorDetails
-			));
-			break;
-		case PluginInterface::DataType_Float32:
-			nnTensorData2D.reset(new DataTable2D<float>(
-				model->getTensorShape(nnCurrentTensorId),
-				model->isTensorComputed(nnCurrentTensorId) ? (*tensorData.get())[nnCurrentTensorId].get() : model->getTensorDataF32(nnCurrentTensorId),
-				&nnTensorDetails
-			));
-			break;
-		case PluginInterface::DataType_Float64:
-			assert(!model->isTensorComputed(nnCurrentTensorId)); // we don't yet support computed tensors of the type float64 because tensorData always has float32
-			nnTensorData2D.reset(new DataTable2D<double>(
-				model->getTensorShape(nnCurrentTensorId),
-				static_cast<const double*>(model->getTensorData(nnCurrentTensorId)),
-				&nnTensorDetails
-			));
-			break;
-		case PluginInterface::DataType_Int8:
-			assert(!model->isTensorComputed(nnCurrentTensorId)); // we don't yet support computed tensors of the type int8 because tensorData always has float32
-			nnTensorData2D.reset(new DataTable2D<int8_t>(
-				model->getTensorShape(nnCurrentTensorId),
-				static_cast<const int8_t*>(model->getTensorData(nnCurrentTensorId)),
-				&nnTensorDetails
-			));
-			break;
-		case PluginInterface::DataType_UInt8:
-			assert(!model->isTensorComputed(nnCurrentTensorId)); // we don't yet support computed tensors of the type uint8 because tensorData always has float32
-			nnTensorData2D.reset(new DataTable2D<uint8_t>(
-				model->getTensorShape(nnCurrentTensorId),
-				static_cast<const uint8_t*>(model->getTensorData(nnCurrentTensorId)),
-				&nnTensorDetails
-			));
-			break;
-		case PluginInterface::DataType_Int16:
-			assert(!model->isTensorComputed(nnCurrentTensorId)); // we don't yet support computed tensors of the type int16 because tensorData always has float32
-			nnTensorData2D.reset(new DataTable2D<int16_t>(
-				model->getTensorShape(nnCurrentTensorId),
-				static_cast<const int16_t*>(model->getTensorData(nnCurrentTensorId)),
-				&nnTensorDetails
-			));
-			break;
-		case PluginInterface::DataType_Int32:
-			assert(!model->isTensorComputed(nnCurrentTensorId)); // we don't yet support computed tensors of the type int32 because tensorData always has float32
-			nnTensorData2D.reset(new DataTable2D<int32_t>(
-				model->getTensorShape(nnCurrentTensorId),
-				static_cast<const int32_t*>(model->getTensorData(nnCurrentTensorId)),
-				&nnTensorDetails
-			));
-			break;
-		case PluginInterface::DataType_Int64:
-			assert(!model->isTensorComputed(nnCurrentTensorId)); // we don't yet support computed tensors of the type int64 because tensorData always has float32
-			nnTensorData2D.reset(new DataTable2D<int64_t>(
-				model->getTensorShape(nnCurrentTensorId),
-				static_cast<const int64_t*>(model->getTensorData(nnCurrentTensorId)),
-				&nnTensorDetails
-			));
-			break;
-		default:
-			FAIL("unsupported tensor data type " << model->getTensorType(nnCurrentTensorId))
-		}
+		nnTensorData2D.reset(DataTable2DBase::create(getTensorData(nnCurrentTensorId), &nnTensorDetails));
 		nnTensorDetailsLayout.addWidget(nnTensorData2D.get(), 3/*row*/, 0/*col*/,  1/*rowSpan*/, 2/*columnSpan*/);
 		nnTensorData2D.get()->setSizePolicy(QSizePolicy::Minimum,   QSizePolicy::Minimum);
 	} else {
@@ -1600,3 +1752,180 @@ void MainWindow::clearNnTensorData2D() {
 	nnTensorDataPlaceholder.show();
 	nnTensorDataPlaceholder1DnotImplemented.hide();
 }
+
+void MainWindow::updateNnTensorData2D() {
+	if (nnCurrentTensorId!=-1 && model->isTensorComputed(nnCurrentTensorId) && haveComputedTensorData(nnCurrentTensorId)) {
+		if (!nnTensorData2D) {
+			showNnTensorData2D();
+		} else if (nnTensorData2D->dataChanged(getTensorData(nnCurrentTensorId))) {
+			nnTensorData2D->setEnabled(true);
+		} else { // the tensor was compacted, it needs a table of a different type
+			clearNnTensorData2D();
+			showNnTensorData2D();
+		}
+	}
+}
+
+void MainWindow::updateTensorPoolStats() {
+	if (!tensorPool) {
+		tensorPoolLabel.setText("");
+		return;
+	}
+	auto stats = tensorPool->getStats();
+	tensorPoolLabel.setText(QString(tr("Tensor pool: %1 hits, %2 misses, %3 bytes in use, %4 bytes pooled"))
+		.arg(stats.hits)
+		.arg(stats.misses)
+		.arg(S2Q(Util::formatUIntHumanReadable(stats.bytesInUse)))
+		.arg(S2Q(Util::formatUIntHumanReadable(stats.bytesPooled))));
+}
+
+void MainWindow::updateMemoryBudgetStats() {
+	if (!memoryBudget) {
+		memoryBudgetLabel.setText("");
+		return;
+	}
+	switch (memoryBudgetPolicy) {
+	case MemoryBudgetPolicy_Recompute:
+		memoryBudgetLabel.setText(QString(tr("Memory budget: %1 bytes, %2 bytes held, %3 tensors released, %4"))
+			.arg(S2Q(Util::formatUIntHumanReadable(memoryBudget)))
+			.arg(S2Q(Util::formatUIntHumanReadable(heldTensorBytes)))
+			.arg(releasedTensors.size())
+			.arg(lastRecomputeMs != -1 ? QString(tr("last recomputed in %1 ms")).arg(lastRecomputeMs) : tr("nothing recomputed")));
+		break;
+	case MemoryBudgetPolicy_Spill: {
+		size_t spilledBytes = 0;
+		for (auto tid : spilledTensors)
+			spilledBytes += (*tensorData)[tid].sizeInBytes();
+		memoryBudgetLabel.setText(QString(tr("Memory budget: %1 bytes, %2 bytes held, %3 tensors with %4 bytes spilled to scratch files"))
+			.arg(S2Q(Util::formatUIntHumanReadable(memoryBudget)))
+			.arg(S2Q(Util::formatUIntHumanReadable(heldTensorBytes)))
+			.arg(spilledTensors.size())
+			.arg(S2Q(Util::formatUIntHumanReadable(spilledBytes))));
+		break;
+	}}
+}
+
+bool MainWindow::runComputation(const std::vector<PluginInterface::TensorId> &targets) {
+	auto cbTensorComputed = [this](PluginInterface::TensorId tensorId) {
+		holdTensor(tensorId);
+	};
+	auto cbWarningMessage = [this](const std::string &msg) {
+		Util::warningOk(this, S2Q(msg));
+	};
+	auto cbTensorConsumed = [this](PluginInterface::TensorId tensorId) {
+		auto &data = (*tensorData)[tensorId];
+		bool overBudget = memoryBudget && (int)tensorId != nnCurrentTensorId && heldTensorBytes > memoryBudget;
+		unholdTensor(tensorId);
+		if (overBudget && memoryBudgetPolicy == MemoryBudgetPolicy_Recompute && !checkpointTensors[tensorId]) {
+			// release it, it will be recomputed from checkpoints when it is inspected
+			data.reset();
+			releasedTensors.insert(tensorId);
+			return;
+		}
+		if (activationStorage != ActivationStorage_Float32) { // keep only a compact copy of the intermediate tensor for inspection
+			// Reshape outputs are views of their inputs: the storage is compacted once, when all its views are consumed,
+			// compacting it earlier would keep the float32 storage alive alongside the compact copy
+			auto &deferred = compactionDeferred[data.storageId()];
+			auto held = heldStorage.find(data.storageId());
+			if (held != heldStorage.end() && std::get<1>(held->second) > deferred.size()) {
+				deferred.push_back(tensorId);
+				holdTensor(tensorId);
+				return;
+			}
+			auto storageId = data.storageId();
+			data = data.compacted(activationStorage, tensorPool.get());
+			for (auto tid : deferred) {
+				(*tensorData)[tid] = data.reshaped(model->getTensorShape(tid));
+				holdTensor(tid);
+			}
+			compactionDeferred.erase(storageId);
+		}
+		if (overBudget && memoryBudgetPolicy == MemoryBudgetPolicy_Spill) {
+			// move it to a scratch file, it will be paged in when it is inspected
+			if (auto spilled = TensorSpill::spill(data)) {
+				data = spilled;
+				spilledTensors.insert(tensorId);
+			}
+		}
+		holdTensor(tensorId);
+	};
+
+	if (targets.empty())
+		spilledTensors.clear(); // all tensors are computed anew, spilled ones are replaced
+	countHeldTensors(); // inputs and tensors that are kept from the previous computation
+	bool succ = Compute::compute(model.get(), tensorData, cbTensorComputed,cbWarningMessage,
+		(memoryBudget || activationStorage != ActivationStorage_Float32) ? cbTensorConsumed : std::function<void(PluginInterface::TensorId)>(),
+		tensorPool.get(),
+		targets);
+
+	compactionDeferred.clear(); // storage of these tensors is still used by tensors that are kept in float32
+
+	// tensors that were recomputed aren't released any more
+	for (auto it = releasedTensors.begin(); it != releasedTensors.end();)
+		it = (*tensorData)[*it] ? releasedTensors.erase(it) : std::next(it);
+
+	updateTensorPoolStats();
+	updateMemoryBudgetStats();
+	return succ;
+}
+
+void MainWindow::holdTensor(PluginInterface::TensorId tensorId) {
+	unholdTensor(tensorId); // it might have been replaced
+	auto &data = (*tensorData)[tensorId];
+	if (!data || spilledTensors.find(tensorId) != spilledTensors.end())
+		return; // only what is in memory
+	auto &held = heldStorage[data.storageId()];
+	if (data.sizeInBytes() > std::get<0>(held)) { // views can be smaller than their storage
+		heldTensorBytes += data.sizeInBytes() - std::get<0>(held);
+		std::get<0>(held) = data.sizeInBytes();
+	}
+	std::get<1>(held)++;
+	heldTensorStorage[tensorId] = data.storageId();
+}
+
+void MainWindow::unholdTensor(PluginInterface::TensorId tensorId) {
+	auto &storageId = heldTensorStorage[tensorId];
+	if (!storageId)
+		return;
+	auto it = heldStorage.find(storageId);
+	if (--std::get<1>(it->second) == 0) {
+		heldTensorBytes -= std::get<0>(it->second);
+		heldStorage.erase(it);
+	}
+	storageId = nullptr;
+}
+
+void MainWindow::countHeldTensors() {
+	heldStorage.clear();
+	heldTensorStorage.clear();
+	heldTensorBytes = 0;
+	if (!tensorData)
+		return;
+	heldTensorStorage.resize(tensorData->size(), nullptr);
+	for (PluginInterface::TensorId tid = 0; tid < tensorData->size(); tid++)
+		holdTensor(tid);
+}
+
+bool MainWindow::haveComputedTensorData(PluginInterface::TensorId tensorId) const {
+	return tensorData && ((*tensorData)[tensorId] || releasedTensors.find(tensorId) != releasedTensors.end());
+}
+
+TensorData MainWindow::getTensorData(PluginInterface::TensorId tensorId) {
+	if (model->isTensorComputed(tensorId)) {
+		if (releasedTensors.find(tensorId) != releasedTensors.end()) { // recompute it from the nearest tensors that are kept
+			QElapsedTimer timer;
+			timer.start();
+			if (!runComputation({tensorId}))
+				PRINT("WARNING recomputation of tensor#" << tensorId << " didn't succeed")
+			lastRecomputeMs = timer.elapsed();
+			updateMemoryBudgetStats();
+		}
+		return (*tensorData)[tensorId];
+	}
+	if (auto mergeDequantize = dynamic_cast<const ModelViews::MergeDequantizeOperators*>(model.get()))
+		if (auto converted = mergeDequantize->getConvertedTensorData(tensorId)) // views share it, releaseConvertedData() doesn't invalidate them
+			return TensorData::adopt(PluginInterface::DataType_Float32, model->getTensorShape(tensorId), converted);
+	auto type = model->getTensorType(tensorId);
+	return TensorData::external(type, model->getTensorShape(tensorId),
+		type == PluginInterface::DataType_Float32 ? model->getTensorDataF32(tensorId) : model->getTensorData(tensorId));
+}
@@ -22,18 +22,25 @@
 #include <QMenuBar>
 #include <QStatusBar>
 #include <QPixmap>
+#include <QImage>
 #include <QRectF>
-#if defined(USE_PERFTOOLS)
 #include <QTimer>
-#endif
+#include <QFileSystemWatcher>
 
 #include "plugin-manager.h"
 #include "plugin-interface.h"
 #include "nn-types.h"
+#include "tensor-data.h"
+#include "tensor-pool.h"
+#include "live-inference.h"
 
 #include <vector>
 #include <array>
+#include <set>
+#include <map>
+#include <tuple>
 #include <memory>
+#include <thread>
 
 class MainWindow : public QMainWindow {
 	Q_OBJECT
@@ -91,6 +98,7 @@ private: // fields
 	QHBoxLayout                                computeLayout;
 	QPushButton                                computeButton;
 	QComboBox                                  computeRegionComboBox;
+	QComboBox                                  computeTargetComboBox;
 	QWidget                                  computeByWidget;
 	QHBoxLayout                                computeByLayout;
 	QLabel                                     inputNormalizationLabel;
@@ -106,6 +114,7 @@ private: // fields
 	QStackedWidget                         sourceImageStack;
 	QScrollArea                              sourceImageScrollArea;
 	QLabel                                     sourceImage;       // index#0
+	QImage                                     sourceImageBuffer; // the image shown in sourceImage, reused when the image is updated
 	std::unique_ptr<QLabel>                  interpretationImage; // index#1: only exists when the interpretation image is possible
 	// Rhs/NN details
 	QStackedWidget                       nnDetailsStack;
@@ -162,16 +171,38 @@ private: // fields
 	QLabel                           memoryUseLabel;
 	QTimer                           memoryUseTimer;
 #endif
+	QLabel                           tensorPoolLabel;
+	QLabel                           memoryBudgetLabel;
+	QLabel                           liveCaptureLabel;
 
 	const PluginManager::Plugin*                   plugin;    // plugin in use for the model
 	std::unique_ptr<PluginInterface>               pluginInterface; // the file is opened through this handle
 	std::unique_ptr<const PluginInterface::Model>  model;     // the model from the file that is currently open
+	std::shared_ptr<TensorPool>                    tensorPool; // recycles buffers of computed tensors of the model between computations
+	QFileSystemWatcher                             modelFileWatcher; // the model is reloaded when its file changes
+	QTimer                                         modelReloadTimer; // the file changes in bursts while it is written
+	std::unique_ptr<LiveInference>                 liveInference; // runs the model on screen captures while the live capture is on
+	QTimer                                         liveCaptureTimer;
+	QAction*                                       liveCaptureAction;
 
 	// data associated with a specific input data (image) currently loaded by the user (static tensors from the model aren't here)
 	TensorShape                      sourceTensorShape;
 	std::shared_ptr<float>           sourceTensorDataAsLoaded; // original image that was loaded by the user
 	std::shared_ptr<float>           sourceTensorDataAsUsed;   // image that is used as an input of NN, might be different if effects are applied
-	std::unique_ptr<std::vector<std::shared_ptr<const float>>>   tensorData; // tensors corresponding to the currently used image, shared because reshape/input often shared
+	std::thread                      effectsThread;            // applies effects to the image in the background, joinable while it is busy
+	unsigned                         effectsGeneration;        // identifies the latest change of effects
+	ActivationStorage                activationStorage; // how intermediate tensors are kept after they were consumed by the computation
+	std::unique_ptr<std::vector<TensorData>> tensorData; // tensors corresponding to the currently used image, storage is shared because reshape/input often shared
+	size_t                           memoryBudget; // bytes of computed tensors to keep in memory, 0 means unlimited
+	MemoryBudgetPolicy               memoryBudgetPolicy; // what happens to tensors beyond the memory budget
+	std::vector<bool>                checkpointTensors; // tensors that are kept regardless of the memory budget
+	std::set<PluginInterface::TensorId> releasedTensors; // tensors released because of the memory budget, they are recomputed when inspected
+	std::set<PluginInterface::TensorId> spilledTensors; // tensors moved to scratch files because of the memory budget
+	std::map<const void*, std::tuple<size_t,unsigned>> heldStorage; // storage of computed tensors that is in memory -> (bytes, number of tensors sharing it)
+	std::vector<const void*>         heldTensorStorage; // tensor -> its storage counted in heldStorage, or nullptr
+	size_t                           heldTensorBytes; // total of heldStorage, it is what the memory budget limits
+	std::map<const void*, std::vector<PluginInterface::TensorId>> compactionDeferred; // storage -> consumed tensors that wait for other views of it to be consumed before it is compacted
+	int                              lastRecomputeMs; // how long did the last recomputation of a released tensor take, -1 if there was none
 
 	std::vector<std::unique_ptr<QWidget>>   tempDetailWidgets;
 
@@ -198,9 +229,10 @@ private: // private methods
 	void effectsChanged();
 	void inputNormalizationChanged();
 	void inputParamsChanged();
-	float* applyEffects(const float *image, const TensorShape &shape,
+	void startApplyingEffects(); // applies the effects chosen now on the effects thread
+	static float* applyEffects(const float *image, const TensorShape &shape,
 		bool flipHorizontally, bool flipVertically, bool makeGrayscale,
-		const std::tuple<TensorShape,std::vector<float>> &convolution, unsigned convolutionCount) const;
+		const std::tuple<TensorShape,std::vector<float>> &convolution, unsigned convolutionCount);
 	void clearEffects();
 	void updateNetworkDetailsPage();
 	void updateSourceImageOnScreen();
@@ -211,8 +243,24 @@ private: // private methods
 	void updateSectionWidgetsVisibility();
 	void onOpenNeuralNetworkFileUserIntent();
 	void closeNeuralNetwork();
+	void reloadModelFile();
+	void startLiveCapture();
+	void stopLiveCapture();
+	void onLiveCaptureTick();
+	static bool openModelFile(const QString &filePath, const PluginManager::Plugin *&plugin, std::unique_ptr<PluginInterface> &pluginInterface,
+		std::unique_ptr<const PluginInterface::Model> &model, QString &error);
+	void setupModel(const QString &filePath); // sets the UI up for the newly opened model
 	static QLabel* makeTextSelectable(QLabel *label);
 	void showNnTensorData2D();
 	void clearNnTensorData2D();
+	void updateNnTensorData2D(); // after the computation, the table follows the new data of the current tensor
+	void updateTensorPoolStats();
+	void updateMemoryBudgetStats();
+	bool runComputation(const std::vector<PluginInterface::TensorId> &targets);
+	void holdTensor(PluginInterface::TensorId tensorId); // counts the tensor in heldTensorBytes, storage shared with other tensors is counted once
+	void unholdTensor(PluginInterface::TensorId tensorId);
+	void countHeldTensors(); // counts all tensors anew
+	bool haveComputedTensorData(PluginInterface::TensorId tensorId) const;
+	TensorData getTensorData(PluginInterface::TensorId tensorId); // computed or static data of the tensor, released tensors are recomputed
 };
 
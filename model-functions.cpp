@@ -146,7 +146,7 @@ float dataRatioOfOperatorModelInputToOuts(const PluginInterface::Model *model, P
 	return float(sizeOfOutputs)/cntOutputs/float(Tensor::flatSize(model->getTensorShape(model->getInputs()[0])));
 }
 
-void computeTensors(const PluginInterface::Model *model, std::vector<std::unique_ptr<float>> *tensorData) {
+void computeTensors(const PluginInterface::Model *model, std::vector<std::unique_ptr<float[]>> *tensorData) {
 }
 
 OutputInterpretationKind guessOutputInterpretationKind(const PluginInterface::Model *model) {
@@ -29,6 +29,19 @@ void renderModelToCoordinates(const PluginInterface::Model *model,
 	std::vector<std::vector<std::vector<std::array<float,2>>>> &tensorLineCubicSplines, // cubic splines
 	std::vector<std::vector<std::array<float,2>>> &tensorLabelPositions // return: tensor label positions in pixels
 );
+void renderModelToCoordinatesLinear( // cheap layout with all boxes in one column in the operator order, same arguments as above
+	const PluginInterface::Model *model,
+	const QMarginsF &operatorBoxMargins,
+	std::function<QSizeF(PluginInterface::OperatorId)> operatorBoxFn,
+	std::function<QSizeF(PluginInterface::TensorId)> inputBoxFn,
+	std::function<QSizeF(PluginInterface::TensorId)> outputBoxFn,
+	Box2 &bbox,
+	std::vector<Box2> &operatorBoxes,
+	std::map<PluginInterface::TensorId, ModelFunctions::Box2> &inputBoxes,
+	std::map<PluginInterface::TensorId, ModelFunctions::Box2> &outputBoxes,
+	std::vector<std::vector<std::vector<std::array<float,2>>>> &tensorLineCubicSplines,
+	std::vector<std::vector<std::array<float,2>>> &tensorLabelPositions
+);
 
 bool isTensorComputed(PluginInterface::TensorId tensorId);
 std::string tensorKind(const PluginInterface::Model *model, PluginInterface::TensorId tensorId);
@@ -39,7 +52,7 @@ size_t sizeOfOperatorStaticData(const PluginInterface::Model *model, PluginInter
 float dataRatioOfOperator(const PluginInterface::Model *model, PluginInterface::OperatorId operatorId);
 float dataRatioOfOperatorModelInputToIns(const PluginInterface::Model *model, PluginInterface::OperatorId operatorId);
 float dataRatioOfOperatorModelInputToOuts(const PluginInterface::Model *model, PluginInterface::OperatorId operatorId);
-void computeTensors(const PluginInterface::Model *model, std::vector<std::unique_ptr<float>> *tensorData);
+void computeTensors(const PluginInterface::Model *model, std::vector<std::unique_ptr<float[]>> *tensorData);
 OutputInterpretationKind guessOutputInterpretationKind(const PluginInterface::Model *model);
 std::string getOperatorExtraInfoString(const PluginInterface::Model *model, PluginInterface::OperatorId operatorId);
 
@@ -0,0 +1,291 @@
+// Copyright (C) 2020 by Yuri Victorovich. All rights reserved.
+
+#include "model-registry.h"
+#include "plugin-manager.h"
+#include "weights-cache.h"
+#include "model-views/merge-dequantize-operators.h"
+#include "misc.h"
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+
+typedef PluginInterface PI;
+
+/// types
+
+struct ModelRegistry::Entry {
+	std::string                                          fileName;
+	std::string                                          dir;        // fileName split for matching file change events
+	std::string                                          baseName;
+	size_t                                               fileSize;
+	const PluginManager::Plugin*                         plugin;
+	std::unique_ptr<PluginInterface>                     pluginInterface;
+	std::unique_ptr<const PI::Model>                     model;
+	const ModelViews::MergeDequantizeOperators*          mergeDequantize; // the view over the original model, or nullptr
+
+	Entry() : fileSize(0), plugin(nullptr), mergeDequantize(nullptr) { }
+	~Entry() {
+		model.reset(nullptr);
+		pluginInterface.reset(nullptr);
+		if (plugin)
+			PluginManager::unloadPlugin(plugin);
+	}
+	size_t memoryUse() const {
+		return fileSize + (mergeDequantize ? mergeDequantize->convertedDataSize() : 0);
+	}
+};
+
+/// local helpers
+
+static const char* fileNameToPluginName(const std::string &filePath) { // match MainWindow::loadModelFile
+	auto endsWith = [](const std::string &fullString, const std::string &ending) {
+		return
+			(fullString.length() >= ending.length()+1)
+			&&
+			(0 == fullString.compare(fullString.length()-ending.length(), ending.length(), ending));
+	};
+	if (endsWith(filePath, ".tflite"))
+		return "tf-lite";
+	else
+		return nullptr;
+}
+
+static void splitPath(const std::string &path, std::string &dir, std::string &baseName) {
+	auto slash = path.rfind('/');
+	dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+	baseName = slash == std::string::npos ? path : path.substr(slash+1);
+}
+
+/// constructor
+
+ModelRegistry::ModelRegistry(size_t memoryCap_, const std::string &weightsCacheDir_)
+: memoryCap(memoryCap_)
+, weightsCacheDir(weightsCacheDir_)
+, numLoads(0)
+, numEvictions(0)
+, numReloads(0)
+, inotifyFd(::inotify_init1(IN_NONBLOCK|IN_CLOEXEC))
+, stopFd(::eventfd(0, EFD_CLOEXEC))
+{
+	if (inotifyFd == -1 || stopFd == -1)
+		WARNING("model files won't be watched for changes: " << strerror(errno))
+	else
+		watchThread = std::thread(&ModelRegistry::watchLoop, this);
+}
+
+ModelRegistry::~ModelRegistry() {
+	if (watchThread.joinable()) {
+		uint64_t one = 1;
+		if (::write(stopFd, &one, sizeof(one)) != sizeof(one))
+			PRINT_ERR("failed to stop the model file watcher: " << strerror(errno))
+		watchThread.join();
+	}
+	if (inotifyFd != -1)
+		::close(inotifyFd);
+	if (stopFd != -1)
+		::close(stopFd);
+}
+
+/// interface
+
+std::shared_ptr<const PI::Model> ModelRegistry::acquire(const std::string &modelFileName, std::string &error) {
+	std::unique_lock<std::mutex> l(lock);
+
+	// find it
+	std::shared_ptr<Entry> entry;
+	while (!entry) {
+		for (auto it = entries.begin(); it != entries.end(); it++)
+			if ((*it)->fileName == modelFileName) {
+				entry = *it;
+				entries.erase(it);
+				break;
+			}
+		if (entry)
+			break;
+
+		// another request is loading it: wait for it and look again
+		auto it = loading.find(modelFileName);
+		if (it == loading.end())
+			break;
+		auto result = it->second;
+		l.unlock();
+		result.wait();
+		l.lock();
+		if (!std::get<0>(result.get())) {
+			error = std::get<1>(result.get());
+			return nullptr;
+		}
+	}
+
+	// load it without the lock: requests for other models aren't held up by it
+	if (!entry) {
+		std::promise<std::tuple<std::shared_ptr<Entry>, std::string>> result;
+		loading[modelFileName] = result.get_future().share();
+		l.unlock();
+		entry = load(modelFileName, error);
+		l.lock();
+		loading.erase(modelFileName);
+		result.set_value({entry, error});
+		if (!entry)
+			return nullptr;
+		numLoads++;
+		watch(*entry);
+	}
+	entries.push_front(entry);
+
+	evict(entry.get());
+
+	// the returned pointer shares the ownership of the entry: entries in use aren't evicted
+	return std::shared_ptr<const PI::Model>(entry, entry->model.get());
+}
+
+ModelRegistry::Stats ModelRegistry::getStats() const {
+	std::unique_lock<std::mutex> l(lock);
+	size_t memoryUse = 0;
+	for (auto &e : entries)
+		memoryUse += e->memoryUse();
+	return Stats{(unsigned)entries.size(), numLoads, numEvictions, numReloads, memoryUse};
+}
+
+/// internals
+
+std::shared_ptr<ModelRegistry::Entry> ModelRegistry::load(const std::string &modelFileName, std::string &error) const {
+	auto pluginName = fileNameToPluginName(modelFileName);
+	if (!pluginName) {
+		error = STR("couldn't find a plugin to open the file '" << modelFileName << "'");
+		return nullptr;
+	}
+
+	auto entry = std::make_shared<Entry>();
+	entry->fileName = modelFileName;
+	splitPath(modelFileName, entry->dir, entry->baseName);
+	entry->plugin = PluginManager::loadPlugin(pluginName);
+	if (!entry->plugin) {
+		error = STR("failed to load the plugin '" << pluginName << "'");
+		return nullptr;
+	}
+	entry->pluginInterface.reset(PluginManager::getInterface(entry->plugin)());
+	if (!entry->pluginInterface->open(modelFileName)) {
+		error = STR("failed to load the model '" << modelFileName << "'");
+		return nullptr;
+	}
+	if (entry->pluginInterface->numModels() != 1) {
+		error = "multi-model files aren't supported yet";
+		return nullptr;
+	}
+	entry->model.reset(entry->pluginInterface->getModel(0));
+	if (!::getenv("NN_INSIGHT_NO_MERGE_DEQUANTIZE_OPERATORS")) {
+		auto weightsCache = weightsCacheDir.empty() ? nullptr : WeightsCache::forModelFile(weightsCacheDir, modelFileName);
+		auto mergeDequantize = new ModelViews::MergeDequantizeOperators(entry->model.release(), weightsCache);
+		entry->model.reset(mergeDequantize);
+		entry->mergeDequantize = mergeDequantize;
+	}
+
+	struct stat sb;
+	if (::stat(modelFileName.c_str(), &sb) == 0)
+		entry->fileSize = sb.st_size; // the plugin maps the whole file
+
+	return entry;
+}
+
+void ModelRegistry::evict(const Entry *keep) {
+	if (memoryCap == 0)
+		return;
+
+	size_t memoryUse = 0;
+	for (auto &e : entries)
+		memoryUse += e->memoryUse();
+
+	// unload from the least recently used end, skipping models in use
+	for (auto it = entries.end(); memoryUse > memoryCap && it != entries.begin();) {
+		it--;
+		if (it->get() == keep || it->use_count() > 1)
+			continue;
+		PRINT("ModelRegistry: unloading the model '" << (*it)->fileName << "' to stay within the memory cap of " << memoryCap << " bytes")
+		memoryUse -= (*it)->memoryUse();
+		it = entries.erase(it);
+		numEvictions++;
+	}
+}
+
+void ModelRegistry::watch(const Entry &entry) {
+	if (!watchThread.joinable())
+		return;
+	// the same directory returns the same watch descriptor
+	int wd = ::inotify_add_watch(inotifyFd, entry.dir.c_str(), IN_CLOSE_WRITE|IN_MOVED_TO);
+	if (wd == -1)
+		WARNING("failed to watch the directory '" << entry.dir << "' for model file changes: " << strerror(errno))
+	else
+		watchedDirs[wd] = entry.dir;
+}
+
+void ModelRegistry::watchLoop() {
+	alignas(struct inotify_event) char buf[4096];
+	while (true) {
+		struct pollfd pfds[2] = {{inotifyFd, POLLIN, 0}, {stopFd, POLLIN, 0}};
+		if (::poll(pfds, 2, -1) == -1) {
+			if (errno == EINTR)
+				continue;
+			PRINT_ERR("failed to wait for model file changes: " << strerror(errno))
+			return;
+		}
+		if (pfds[1].revents)
+			return; // stopping
+
+		// collect the changed model files
+		std::vector<std::string> changed;
+		ssize_t len;
+		while ((len = ::read(inotifyFd, buf, sizeof(buf))) > 0)
+			for (char *p = buf; p < buf + len; ) {
+				auto ev = reinterpret_cast<const struct inotify_event*>(p);
+				p += sizeof(struct inotify_event) + ev->len;
+				if (ev->len == 0)
+					continue;
+				std::unique_lock<std::mutex> l(lock);
+				auto d = watchedDirs.find(ev->wd);
+				if (d == watchedDirs.end())
+					continue;
+				for (auto &e : entries)
+					if (e->dir == d->second && e->baseName == ev->name && std::find(changed.begin(), changed.end(), e->fileName) == changed.end())
+						changed.push_back(e->fileName);
+			}
+
+		for (auto &fileName : changed)
+			reload(fileName);
+	}
+}
+
+void ModelRegistry::reload(const std::string &modelFileName) {
+	// load and prepare the new version without holding the lock: requests keep using the old version meanwhile
+	std::string error;
+	auto entry = load(modelFileName, error);
+	if (!entry) {
+		PRINT_ERR("ModelRegistry: failed to reload the changed model file '" << modelFileName << "', keeping the loaded version: " << error)
+		return;
+	}
+	for (PI::TensorId tid = 0, tide = entry->model->numTensors(); tid < tide; tid++) // convert derived weights now rather than in the first requests
+		if (entry->model->getTensorHasData(tid) && entry->model->getTensorType(tid) == PI::DataType_Float32)
+			(void)entry->model->getTensorDataF32(tid);
+
+	// swap it in at the same position in the LRU order
+	std::unique_lock<std::mutex> l(lock);
+	for (auto &e : entries)
+		if (e->fileName == modelFileName) {
+			e = entry; // the old version is released by the last request that holds it
+			numReloads++;
+			PRINT("ModelRegistry: reloaded the changed model file '" << modelFileName << "'")
+			return;
+		}
+	// it was unloaded meanwhile, the new version is loaded on demand
+}
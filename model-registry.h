@@ -0,0 +1,65 @@
+// Copyright (C) 2020 by Yuri Victorovich. All rights reserved.
+
+#pragma once
+
+#include "plugin-interface.h"
+
+#include <string>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <future>
+#include <tuple>
+#include <thread>
+
+// ModelRegistry keeps several models loaded at once: models are loaded on first use,
+// and the least recently used models that aren't in use are unloaded while the memory cap is exceeded
+// model files are watched: when a loaded model file is replaced its new version is loaded and prepared in the background
+// and then replaces the old one, requests that still use the old version keep it until they finish
+class ModelRegistry {
+	typedef PluginInterface PI;
+
+public: // types
+	struct Stats {
+		unsigned numResident;
+		size_t   numLoads;
+		size_t   numEvictions;
+		size_t   numReloads;
+		size_t   memoryUse;  // bytes of mapped model files and derived weights
+	};
+
+private: // types
+	struct Entry;
+	typedef std::shared_future<std::tuple<std::shared_ptr<Entry>, std::string>> Loading; // the entry, or nullptr and the error
+
+private: // fields
+	size_t                               memoryCap;       // bytes, 0 means no limit
+	std::string                          weightsCacheDir; // derived weights are shared through files in this directory when it isn't empty
+	mutable std::mutex                   lock;
+	std::list<std::shared_ptr<Entry>>    entries;         // most recently used first
+	std::map<std::string, Loading>       loading;         // files that are being loaded without the lock, other requests for them wait for the result
+	size_t                               numLoads;
+	size_t                               numEvictions;
+	size_t                               numReloads;
+	// file watching
+	int                                  inotifyFd;
+	int                                  stopFd;          // eventfd that stops the watch thread
+	std::map<int, std::string>           watchedDirs;     // inotify watch descriptor -> directory, under the lock
+	std::thread                          watchThread;
+
+public: // constructor
+	ModelRegistry(size_t memoryCap_, const std::string &weightsCacheDir_);
+	~ModelRegistry();
+
+public: // interface
+	std::shared_ptr<const PI::Model> acquire(const std::string &modelFileName, std::string &error); // the model stays loaded while the returned pointer is held
+	Stats getStats() const;
+
+private: // internals
+	std::shared_ptr<Entry> load(const std::string &modelFileName, std::string &error) const;
+	void evict(const Entry *keep);
+	void watch(const Entry &entry); // the directory is watched because files are usually replaced by renaming a new file over them
+	void watchLoop();
+	void reload(const std::string &modelFileName);
+};
@@ -0,0 +1,246 @@
+// Copyright (C) 2020 by Yuri Victorovich. All rights reserved.
+
+#include "model-scene.h"
+#include "model-functions.h"
+#include "plugin-interface.h"
+#include "misc.h"
+#include "util.h"
+#include "fonts.h"
+#include "constant-values.h"
+#include "colors.h"
+
+#include <QPainter>
+#include <QPainterPath>
+#include <QFontMetrics>
+#include <QFontMetricsF>
+#include <QMarginsF>
+#include <QPen>
+
+#include <vector>
+#include <array>
+#include <map>
+#include <cmath>
+#include <algorithm>
+
+#include <assert.h>
+
+// options
+static const float  gridCellSize               = 256;  // pixels of the unscaled drawing
+static const qreal  operatorBoxRadius          = 5;
+static const qreal  operatorBoxBorderWidth     = 2;
+static const QColor clrOperatorBorder          = Qt::black;
+static const QColor clrOperatorTitleText       = Qt::white;
+static const QColor clrTensorLine              = Qt::black;
+static const QColor clrTensorLabel             = Qt::black;
+// level of detail: what is drawn depends on how large it is on the screen
+static const qreal  lodMinTextPixels           = 5;    // smaller texts are skipped
+static const qreal  lodMinDetailedScale        = 0.5;  // below this scale boxes are plain rectangles and tensor lines are straight
+static const qreal  lodMinItemPixels           = 1;    // smaller items are skipped
+
+/// constructor
+
+ModelScene::ModelScene(const QSizeF &size_)
+: size(size_)
+, cellSize(gridCellSize)
+, numCellsX(std::max(1u, (unsigned)std::ceil(size_.width()/gridCellSize)))
+, numCellsY(std::max(1u, (unsigned)std::ceil(size_.height()/gridCellSize)))
+, cells(numCellsX*numCellsY)
+{
+}
+
+/// generation
+
+std::shared_ptr<const ModelScene> ModelScene::generate(const PluginInterface::Model *model, bool linearLayout) {
+	auto dpi = Util::getScreenDPI();
+	auto inchesToPixels = [dpi](float inches) {
+		return inches*dpi;
+	};
+	auto pixelsToInches = [dpi](float pixels) {
+		return pixels/dpi;
+	};
+	auto inputLabel = [&](PluginInterface::TensorId tensorId) {
+		return model->getTensorName(tensorId);
+	};
+	auto outputLabel = [&](PluginInterface::TensorId tensorId) {
+		return model->getTensorName(tensorId);
+	};
+
+	// render the model to the coordinates
+	ModelFunctions::Box2 graphBBox;
+	std::vector<ModelFunctions::Box2> operatorBoxes;
+	std::map<PluginInterface::TensorId, ModelFunctions::Box2> inputBoxes;
+	std::map<PluginInterface::TensorId, ModelFunctions::Box2> outputBoxes;
+	std::vector<std::vector<std::vector<std::array<float,2>>>> tensorLineCubicSplines;
+	std::vector<std::vector<std::array<float,2>>> tensorLabelPositions;
+	{
+		QFontMetrics fm(Fonts::fontOperatorTitle);
+		(linearLayout ? ModelFunctions::renderModelToCoordinatesLinear : ModelFunctions::renderModelToCoordinates)(model,
+			QMarginsF(0.15, 0.04, 0.15, 0.04), // operator box margins in inches
+			[&](PluginInterface::OperatorId oid) { // operatorBoxFn
+				auto szPixels = fm.size(Qt::TextSingleLine, S2Q(STR(model->getOperatorKind(oid))));
+				return QSizeF(pixelsToInches(szPixels.width()), pixelsToInches(szPixels.height()));
+			},
+			[&](PluginInterface::TensorId tid) { // inputBoxFn
+				auto szPixels = fm.size(Qt::TextSingleLine, S2Q(inputLabel(tid)));
+				return QSizeF(pixelsToInches(szPixels.width()), pixelsToInches(szPixels.height()));
+			},
+			[&](PluginInterface::TensorId tid) { // outputBoxFn
+				auto szPixels = fm.size(Qt::TextSingleLine, S2Q(outputLabel(tid)));
+				return QSizeF(pixelsToInches(szPixels.width()), pixelsToInches(szPixels.height()));
+			},
+			graphBBox,
+			operatorBoxes,
+			inputBoxes,
+			outputBoxes,
+			tensorLineCubicSplines,
+			tensorLabelPositions
+		);
+
+		// convert bbox inches->pixels
+		assert(graphBBox[0][0]==0 && graphBBox[0][0]==0);
+		graphBBox[1][0] = inchesToPixels(graphBBox[1][0]); // width
+		graphBBox[1][1] = inchesToPixels(graphBBox[1][1]); // height
+	}
+
+	// coordinate conversions: Graphviz has Y going up, the drawing has margins around the graph
+	float marginPixelsX = ConstantValues::nnDisplayMarginInchesX*dpi;
+	float marginPixelsY = ConstantValues::nnDisplayMarginInchesY*dpi;
+	auto dotPointToQPointF = [&](const std::array<float,2> &pt) {
+		return QPointF(marginPixelsX + inchesToPixels(pt[0]), marginPixelsY + graphBBox[1][1] - inchesToPixels(pt[1]));
+	};
+	auto dotBoxToQRectF = [&](const ModelFunctions::Box2 &box2) { // box2 is (center, size)
+		QSizeF size(inchesToPixels(box2[1][0]), inchesToPixels(box2[1][1]));
+		return QRectF(dotPointToQPointF(box2[0]) - QPointF(size.width()/2, size.height()/2), size);
+	};
+
+	auto scene = std::make_shared<ModelScene>(QSizeF(graphBBox[1][0] + 2*marginPixelsX, graphBBox[1][1] + 2*marginPixelsY));
+
+	// operator boxes
+	for (PluginInterface::OperatorId oid = 0, oide = operatorBoxes.size(); oid < oide; oid++)
+		scene->add({ItemKind_Operator, oid, dotBoxToQRectF(operatorBoxes[oid]),
+			S2Q(STR(model->getOperatorKind(oid) << ModelFunctions::getOperatorExtraInfoString(model, oid))),
+			Colors::getOperatorColor(model->getOperatorKind(oid)), QPainterPath()});
+
+	// input and output boxes
+	for (auto it : inputBoxes)
+		scene->add({ItemKind_Input, it.first, dotBoxToQRectF(it.second), S2Q(inputLabel(it.first)), Qt::gray, QPainterPath()});
+	for (auto it : outputBoxes)
+		scene->add({ItemKind_Output, it.first, dotBoxToQRectF(it.second), S2Q(outputLabel(it.first)), Qt::gray, QPainterPath()});
+
+	// tensor lines
+	for (PluginInterface::TensorId tid = 0, tide = tensorLineCubicSplines.size(); tid < tide; tid++)
+		for (auto &splines : tensorLineCubicSplines[tid]) { // not all tensors are between operators, so the spline list here can be empty
+			assert(splines.size()>2 && (splines.size()-2)%3 == 1); // {startp,endp, 1+3n}
+			QPainterPath path;
+			// splines
+			path.moveTo(dotPointToQPointF(splines[2+0]));
+			for (unsigned i = 2+1; i+2 < splines.size(); i += 3)
+				path.cubicTo(dotPointToQPointF(splines[i+0]), dotPointToQPointF(splines[i+1]), dotPointToQPointF(splines[i+2]));
+			// startp
+			assert(splines[0][0] == -1); // we don't support startp yet
+			// endp
+			if (splines[1][0] != -1)
+				path.lineTo(dotPointToQPointF(splines[1])); // TODO draw the arrow here
+			scene->add({ItemKind_TensorLine, tid, path.boundingRect(), QString(), QColor(), path});
+		}
+
+	// tensor labels
+	QFontMetrics fm(Fonts::fontTensorLabel);
+	for (PluginInterface::TensorId tid = 0, tide = tensorLabelPositions.size(); tid < tide; tid++)
+		for (auto &pos : tensorLabelPositions[tid]) { // not all tensors are between operators, so the label list here can be empty
+			auto label = S2Q(STR(model->getTensorShape(tid)));
+			auto textSize = fm.size(Qt::TextSingleLine, label);
+			QPointF textSizeHalf(textSize.width()/2, textSize.height()/2);
+			auto pt = dotPointToQPointF(pos);
+			scene->add({ItemKind_TensorLabel, tid, QRectF(pt - textSizeHalf, pt + textSizeHalf), label, QColor(), QPainterPath()});
+		}
+
+	return scene;
+}
+
+void ModelScene::add(Item &&item) {
+	assert(items.empty() || items.back().kind <= item.kind);
+	unsigned cx0, cy0, cx1, cy1;
+	if (cellRange(item.rect, cx0, cy0, cx1, cy1))
+		for (unsigned cy = cy0; cy <= cy1; cy++)
+			for (unsigned cx = cx0; cx <= cx1; cx++)
+				cells[cy*numCellsX + cx].push_back(items.size());
+	items.push_back(std::move(item));
+}
+
+/// interface
+
+void ModelScene::paint(QPainter &painter, const QRectF &rect, qreal scale) const {
+	// visible items in the painting order
+	std::vector<uint32_t> visible;
+	forEachItemIn(rect, [&visible](uint32_t idx) {
+		visible.push_back(idx);
+	});
+	std::sort(visible.begin(), visible.end());
+
+	// level of detail
+	bool drawTitles = QFontMetricsF(Fonts::fontOperatorTitle).height()*scale >= lodMinTextPixels;
+	bool drawLabels = QFontMetricsF(Fonts::fontTensorLabel).height()*scale >= lodMinTextPixels;
+	bool drawDetails = scale >= lodMinDetailedScale;
+
+	QPen penBorder(clrOperatorBorder, operatorBoxBorderWidth);
+	int lastKind = -1; // fonts and pens are only changed between kinds
+	for (auto idx : visible) {
+		auto &item = items[idx];
+		if (std::max(item.rect.width(), item.rect.height())*scale < lodMinItemPixels)
+			continue;
+		switch (item.kind) {
+		case ItemKind_Operator:
+		case ItemKind_Input:
+		case ItemKind_Output:
+			if (lastKind != item.kind)
+				painter.setFont(Fonts::fontOperatorTitle);
+			if (drawDetails) {
+				QPainterPath path;
+				path.addRoundedRect(item.rect, operatorBoxRadius, operatorBoxRadius);
+				painter.setPen(penBorder);
+				painter.fillPath(path, item.color);
+				painter.drawPath(path);
+			} else
+				painter.fillRect(item.rect, item.color);
+			if (drawTitles) {
+				painter.setPen(clrOperatorTitleText);
+				painter.drawText(item.rect, Qt::AlignCenter, item.text);
+			}
+			break;
+		case ItemKind_TensorLine:
+			if (lastKind != item.kind)
+				painter.setPen(clrTensorLine);
+			if (drawDetails)
+				painter.drawPath(item.path);
+			else
+				painter.drawLine(item.path.elementAt(0), item.path.currentPosition());
+			break;
+		case ItemKind_TensorLabel:
+			if (!drawLabels)
+				return; // labels are the last
+			if (lastKind != item.kind) {
+				painter.setPen(clrTensorLabel);
+				painter.setFont(Fonts::fontTensorLabel);
+			}
+			painter.drawText(item.rect, Qt::AlignCenter, item.text);
+			break;
+		}
+		lastKind = item.kind;
+	}
+}
+
+/// internals
+
+bool ModelScene::cellRange(const QRectF &rect, unsigned &cx0, unsigned &cy0, unsigned &cx1, unsigned &cy1) const {
+	if (rect.right() < 0 || rect.bottom() < 0 || rect.left() > size.width() || rect.top() > size.height())
+		return false;
+	auto cell = [this](qreal coord, unsigned numCells) {
+		return std::min(numCells-1, (unsigned)std::max(qreal(0), coord/cellSize));
+	};
+	cx0 = cell(rect.left(), numCellsX);
+	cy0 = cell(rect.top(), numCellsY);
+	cx1 = cell(rect.right(), numCellsX);
+	cy1 = cell(rect.bottom(), numCellsY);
+	return true;
+}
@@ -0,0 +1,87 @@
+// Copyright (C) 2020 by Yuri Victorovich. All rights reserved.
+
+#pragma once
+
+#include "plugin-interface.h"
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include <stdint.h>
+
+#include <QRectF>
+#include <QSizeF>
+#include <QString>
+#include <QColor>
+#include <QPainterPath>
+class QPainter;
+
+// ModelScene is the drawing of the model graph as a list of items in pixels of the unscaled drawing:
+// items are registered in the cells of a grid that covers the drawing, so that painting and searches
+// only visit items near the area of interest instead of all items in the model
+class ModelScene {
+public: // types
+	enum ItemKind { // also the painting order
+		ItemKind_Operator,
+		ItemKind_Input,
+		ItemKind_Output,
+		ItemKind_TensorLine,
+		ItemKind_TensorLabel
+	};
+	struct Item {
+		ItemKind       kind;
+		unsigned       id;      // OperatorId for operators, TensorId for everything else
+		QRectF         rect;    // box, or bounds of the line
+		QString        text;    // box title or label
+		QColor         color;   // box background
+		QPainterPath   path;    // tensor line
+	};
+
+private: // fields
+	QSizeF                               size;
+	float                                cellSize;
+	unsigned                             numCellsX;
+	unsigned                             numCellsY;
+	std::vector<Item>                    items;    // in the painting order
+	std::vector<std::vector<uint32_t>>   cells;    // item indexes in each cell, ascending
+
+public: // constructor
+	ModelScene(const QSizeF &size_);
+
+public: // generation
+	static std::shared_ptr<const ModelScene> generate(const PluginInterface::Model *model, bool linearLayout);
+	void add(Item &&item); // items have to be added in the painting order
+
+public: // interface
+	const QSizeF& getSize() const {return size;}
+	unsigned numItems() const {return items.size();}
+	const Item& getItem(unsigned idx) const {return items[idx];}
+	void paint(QPainter &painter, const QRectF &rect, qreal scale) const; // paints items that intersect rect, the painter is already scaled by scale
+
+	// calls fn(itemIndex) once for every item with bounds intersecting rect, in the ascending order of item indexes within each cell
+	template<typename Fn>
+	void forEachItemIn(const QRectF &rect, Fn fn) const {
+		unsigned cx0, cy0, cx1, cy1;
+		if (!cellRange(rect, cx0, cy0, cx1, cy1))
+			return;
+		for (unsigned cy = cy0; cy <= cy1; cy++)
+			for (unsigned cx = cx0; cx <= cx1; cx++)
+				for (auto idx : cells[cy*numCellsX + cx]) {
+					auto &item = items[idx];
+					if (!overlap(item.rect, rect))
+						continue;
+					// items spanning several cells are only reported in the first cell of the range where they are
+					unsigned icx0, icy0, icx1, icy1;
+					cellRange(item.rect, icx0, icy0, icx1, icy1);
+					if (cx == std::max(cx0, icx0) && cy == std::max(cy0, icy0))
+						fn(idx);
+				}
+	}
+
+private: // internals
+	static bool overlap(const QRectF &a, const QRectF &b) { // unlike QRectF::intersects also works with lines and points
+		return a.left() <= b.right() && b.left() <= a.right() && a.top() <= b.bottom() && b.top() <= a.bottom();
+	}
+	bool cellRange(const QRectF &rect, unsigned &cx0, unsigned &cy0, unsigned &cx1, unsigned &cy1) const;
+};
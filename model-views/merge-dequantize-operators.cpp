@@ -4,21 +4,45 @@
 
 #include "../misc.h"
 #include "../tensor.h"
+#include "../parallel.h"
 
 #include <half.hpp>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
 namespace ModelViews {
 
 typedef PluginInterface PI;
 
-MergeDequantizeOperators::MergeDequantizeOperators(const PluginInterface::Model *original_)
+/// local helpers
+
+#if defined(__x86_64__) || defined(__i386__)
+// F16C instructions are used when the CPU has them, the build doesn't need to target such CPUs
+__attribute__((target("avx,f16c")))
+static size_t convertFloat16F16C(const half_float::half *src, float *dst, size_t b, size_t e) {
+	for (; b+8 <= e; b += 8)
+		_mm256_storeu_ps(dst+b, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(src+b))));
+	return b;
+}
+
+static bool haveF16C() {
+	static bool have = __builtin_cpu_supports("f16c");
+	return have;
+}
+#endif
+
+MergeDequantizeOperators::MergeDequantizeOperators(const PluginInterface::Model *original_, std::shared_ptr<WeightsCache> weightsCache_)
 : original(original_),
-  tensorData(new std::vector<std::shared_ptr<const float>>)
+  tensorData(new std::vector<std::shared_ptr<const float>>),
+  weightsCache(weightsCache_)
 {
 	// find all dequantize operators and their tensor outputs
 	unsigned numDequantizeOperators = 0;
 	tensorIsDequantizeInput  .resize(original->numTensors());
 	tensorIsDequantizeOutput .resize(original->numTensors());
+	dequantizeSource         .resize(original->numTensors());
 	tensorData              ->resize(original->numTensors());
 	for (PI::OperatorId oid = 0, oide = original->numOperators(); oid < oide; oid++)
 		if (original->getOperatorKind(oid) == PI::KindDequantize) {
@@ -33,11 +57,7 @@ MergeDequantizeOperators::MergeDequantizeOperators(const PluginInterface::Model
 				FAIL("MergeDequantizeOperators: Dequantize operator tensor types aren't consistent with Dequantize definition")
 			tensorIsDequantizeInput[inputs[0]] = true;
 			tensorIsDequantizeOutput[outputs[0]] = true;
-			(*tensorData)[outputs[0]].reset(convertStaticArrayToFloat32(
-				original->getTensorData(inputs[0]),
-				original->getTensorType(inputs[0]),
-				original->getTensorShape(inputs[0])
-			));
+			dequantizeSource[outputs[0]] = inputs[0]; // conversion is deferred until the data is first requested
 		} else
 			operatorMap.push_back(oid);
 	// print a notice to the user
@@ -115,7 +135,7 @@ const void* MergeDequantizeOperators::getTensorData(PI::TensorId tensorId) const
 const float* MergeDequantizeOperators::getTensorDataF32(PI::TensorId tensorId) const {
 	assert(!tensorIsDequantizeInput[tensorId]); // dequantize input can't be queried
 	if (tensorIsDequantizeOutput[tensorId])
-		return (*tensorData)[tensorId].get();
+		return getConvertedData(tensorId).get(); // it is valid until releaseConvertedData() is called
 	else
 		return original->getTensorDataF32(tensorId);
 }
@@ -125,21 +145,76 @@ bool MergeDequantizeOperators::getTensorIsVariableFlag(PI::TensorId tensorId) co
 	return original->getTensorIsVariableFlag(tensorId);
 }
 
-const float* MergeDequantizeOperators::convertStaticArrayToFloat32(const void *array, PI::DataType dataType, const TensorShape &shape) {
+/// own interface
+
+size_t MergeDequantizeOperators::releaseConvertedData() const {
+	// the caller should make sure that no computation is in progress because it might hold raw pointers to these buffers
+	std::unique_lock<std::mutex> lock(tensorDataLock);
+	size_t bytes = 0;
+	for (PI::TensorId tid = 0, tide = tensorData->size(); tid < tide; tid++)
+		if ((*tensorData)[tid]) {
+			bytes += Tensor::flatSize(original->getTensorShape(tid))*sizeof(float);
+			(*tensorData)[tid].reset();
+		}
+	return bytes;
+}
+
+size_t MergeDequantizeOperators::convertedDataSize() const {
+	std::unique_lock<std::mutex> lock(tensorDataLock);
+	size_t bytes = 0;
+	for (PI::TensorId tid = 0, tide = tensorData->size(); tid < tide; tid++)
+		if ((*tensorData)[tid])
+			bytes += Tensor::flatSize(original->getTensorShape(tid))*sizeof(float);
+	return bytes;
+}
+
+std::shared_ptr<const float> MergeDequantizeOperators::getConvertedTensorData(PI::TensorId tensorId) const {
+	assert(!tensorIsDequantizeInput[tensorId]); // dequantize input can't be queried
+	return tensorIsDequantizeOutput[tensorId] ? getConvertedData(tensorId) : nullptr;
+}
+
+/// internals
+
+std::shared_ptr<const float> MergeDequantizeOperators::getConvertedData(PI::TensorId tensorId) const {
+	std::unique_lock<std::mutex> lock(tensorDataLock);
+	auto &data = (*tensorData)[tensorId];
+	if (!data) {
+		auto srcId = dequantizeSource[tensorId];
+		auto shape = original->getTensorShape(srcId);
+		auto convert = [this,srcId,&shape](float *dst) {
+			convertStaticArrayToFloat32(original->getTensorData(srcId), original->getTensorType(srcId), shape, dst);
+		};
+		if (weightsCache)
+			data = weightsCache->get(tensorId, Tensor::flatSize(shape), convert);
+		if (!data) { // no cache, or it failed
+			std::unique_ptr<float[]> f(new float[Tensor::flatSize(shape)]);
+			convert(f.get());
+			data.reset(f.release(), [](const float *p) {delete [] p;});
+		}
+	}
+	return data;
+}
+
+void MergeDequantizeOperators::convertStaticArrayToFloat32(const void *array, PI::DataType dataType, const TensorShape &shape, float *dst) {
 	auto shapeSize = Tensor::flatSize(shape);
 	assert(dataType != PI::DataType_Float32);
 	switch (dataType) {
-	case PI::DataType_Float16: { // float16->float is performed through the 'half' library for half-precision floating point arithmetic
-		std::unique_ptr<float> f(new float[shapeSize]);
-		float *pf = f.get();
-		for (const uint8_t *p = static_cast<const uint8_t*>(array), *pe = p + 2*shapeSize; p < pe; p += 2)
-			*pf++ = *(const half_float::half*)p;
-		return f.release();
+	case PI::DataType_Float16: { // float16->float is performed with F16C instructions when the CPU has them, otherwise through the 'half' library
+		float *pf = dst;
+		auto ph = static_cast<const half_float::half*>(array);
+		Parallel::forRange(shapeSize, 1<<16/*elements per thread at least*/, [pf,ph](size_t b, size_t e) {
+#if defined(__x86_64__) || defined(__i386__)
+			if (haveF16C())
+				b = convertFloat16F16C(ph, pf, b, e);
+#endif
+			for (; b < e; b++)
+				pf[b] = ph[b];
+		});
+		return;
 	}
 	default:
 		FAIL("Unknown data type " << dataType << " in conversion to float32")
 	}
-	return nullptr;
 }
 
 } // ModelViews
@@ -3,9 +3,11 @@
 #pragma once
 
 #include "../plugin-interface.h"
+#include "../weights-cache.h"
 
 #include <memory>
 #include <vector>
+#include <mutex>
 
 namespace ModelViews {
 
@@ -19,10 +21,18 @@ class MergeDequantizeOperators : public PluginInterface::Model {
 	std::vector<PI::OperatorId>                   operatorMap; // view operator to original operator mapping
 	std::vector<bool>                             tensorIsDequantizeInput;
 	std::vector<bool>                             tensorIsDequantizeOutput;
-	std::unique_ptr<std::vector<std::shared_ptr<const float>>>   tensorData; // tensors corresponding to the outputs of Dequantize operators
+	std::vector<PI::TensorId>                     dequantizeSource; // Dequantize output -> Dequantize input
+	mutable std::mutex                            tensorDataLock;
+	mutable std::unique_ptr<std::vector<std::shared_ptr<const float>>>   tensorData; // tensors corresponding to the outputs of Dequantize operators, converted lazily on first access
+	std::shared_ptr<WeightsCache>                 weightsCache; // converted tensors are shared through it when present
 
 public:
-	MergeDequantizeOperators(const PluginInterface::Model *original_);
+	MergeDequantizeOperators(const PluginInterface::Model *original_, std::shared_ptr<WeightsCache> weightsCache_ = nullptr);
+
+public: // own interface
+	size_t                      releaseConvertedData() const; // frees all converted buffers, they are re-converted on next access, returns the number of bytes released
+	size_t                      convertedDataSize() const; // bytes in converted buffers
+	std::shared_ptr<const float> getConvertedTensorData(PI::TensorId tensorId) const; // shares the ownership of the converted buffer, so that releaseConvertedData() can't invalidate it, nullptr for tensors that aren't converted
 
 public: // interface implementation
 	unsigned                    numInputs() const override;
@@ -43,7 +53,8 @@ public: // interface implementation
 	bool                        getTensorIsVariableFlag(PI::TensorId tensorId) const override;
 
 private: // internals
-	static const float* convertStaticArrayToFloat32(const void *array, PI::DataType dataType, const TensorShape &shape);
+	std::shared_ptr<const float> getConvertedData(PI::TensorId tensorId) const;
+	static void convertStaticArrayToFloat32(const void *array, PI::DataType dataType, const TensorShape &shape, float *dst);
 }; // MergeDequantize
 
 } // ModelViews
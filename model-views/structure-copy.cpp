@@ -0,0 +1,122 @@
+// Copyright (C) 2020 by Yuri Victorovich. All rights reserved.
+
+#include "structure-copy.h"
+
+#include "../misc.h"
+
+#include <memory>
+
+#include <assert.h>
+
+namespace ModelViews {
+
+typedef PluginInterface PI;
+
+StructureCopy::StructureCopy(const PluginInterface::Model *original)
+: inputs(original->getInputs()),
+  outputs(original->getOutputs())
+{
+	operators.resize(original->numOperators());
+	for (PI::OperatorId oid = 0, oide = operators.size(); oid < oide; oid++) {
+		auto &op = operators[oid];
+		op.kind = original->getOperatorKind(oid);
+		original->getOperatorIo(oid, op.inputs, op.outputs);
+		std::unique_ptr<PI::OperatorOptionsList> opts(original->getOperatorOptions(oid));
+		if (opts)
+			op.options = *opts;
+	}
+	tensors.resize(original->numTensors());
+	auto copyTensor = [this,original](PI::TensorId tid) {
+		auto &t = tensors[tid];
+		if (t.copied)
+			return;
+		t.shape      = original->getTensorShape(tid);
+		t.type       = original->getTensorType(tid);
+		t.name       = original->getTensorName(tid);
+		t.hasData    = original->getTensorHasData(tid);
+		t.isVariable = original->getTensorIsVariableFlag(tid);
+		t.copied     = true;
+	};
+	for (auto tid : inputs)
+		copyTensor(tid);
+	for (auto tid : outputs)
+		copyTensor(tid);
+	for (auto &op : operators) {
+		for (auto tid : op.inputs)
+			copyTensor(tid);
+		for (auto tid : op.outputs)
+			copyTensor(tid);
+	}
+}
+
+unsigned StructureCopy::numInputs() const {
+	return inputs.size();
+}
+
+std::vector<PI::TensorId> StructureCopy::getInputs() const {
+	return inputs;
+}
+
+unsigned StructureCopy::numOutputs() const {
+	return outputs.size();
+}
+
+std::vector<PI::TensorId> StructureCopy::getOutputs() const {
+	return outputs;
+}
+
+unsigned StructureCopy::numOperators() const {
+	return operators.size();
+}
+
+void StructureCopy::getOperatorIo(unsigned operatorIdx, std::vector<PI::TensorId> &inputs, std::vector<PI::TensorId> &outputs) const {
+	inputs = operators[operatorIdx].inputs;
+	outputs = operators[operatorIdx].outputs;
+}
+
+PI::OperatorKind StructureCopy::getOperatorKind(unsigned operatorIdx) const {
+	return operators[operatorIdx].kind;
+}
+
+PI::OperatorOptionsList* StructureCopy::getOperatorOptions(unsigned operatorIdx) const {
+	return new PI::OperatorOptionsList(operators[operatorIdx].options);
+}
+
+unsigned StructureCopy::numTensors() const {
+	return tensors.size();
+}
+
+TensorShape StructureCopy::getTensorShape(PI::TensorId tensorId) const {
+	assert(tensors[tensorId].copied); // operators, inputs and outputs don't refer to other tensors
+	return tensors[tensorId].shape;
+}
+
+PI::DataType StructureCopy::getTensorType(PI::TensorId tensorId) const {
+	assert(tensors[tensorId].copied); // operators, inputs and outputs don't refer to other tensors
+	return tensors[tensorId].type;
+}
+
+std::string StructureCopy::getTensorName(PI::TensorId tensorId) const {
+	assert(tensors[tensorId].copied); // operators, inputs and outputs don't refer to other tensors
+	return tensors[tensorId].name;
+}
+
+bool StructureCopy::getTensorHasData(PI::TensorId tensorId) const {
+	assert(tensors[tensorId].copied); // operators, inputs and outputs don't refer to other tensors
+	return tensors[tensorId].hasData;
+}
+
+const void* StructureCopy::getTensorData(PI::TensorId tensorId) const {
+	FAIL("StructureCopy: static tensor data isn't copied, tensor#" << tensorId << " data was requested")
+}
+
+const float* StructureCopy::getTensorDataF32(PI::TensorId tensorId) const {
+	FAIL("StructureCopy: static tensor data isn't copied, tensor#" << tensorId << " data was requested")
+}
+
+bool StructureCopy::getTensorIsVariableFlag(PI::TensorId tensorId) const {
+	assert(tensors[tensorId].copied); // operators, inputs and outputs don't refer to other tensors
+	return tensors[tensorId].isVariable;
+}
+
+} // ModelViews
@@ -0,0 +1,62 @@
+// Copyright (C) 2020 by Yuri Victorovich. All rights reserved.
+
+#pragma once
+
+#include "../plugin-interface.h"
+
+#include <string>
+#include <vector>
+
+namespace ModelViews {
+
+// StructureCopy is the copy of the model without static tensor data:
+// it doesn't depend on the original model, so that it can be used on other threads after the original model is closed
+// only tensors that operators, inputs and outputs refer to are copied, some views don't allow to query others
+class StructureCopy : public PluginInterface::Model {
+
+// types
+	typedef PluginInterface PI;
+	struct Operator {
+		PI::OperatorKind             kind;
+		std::vector<PI::TensorId>    inputs;
+		std::vector<PI::TensorId>    outputs;
+		PI::OperatorOptionsList      options;
+	};
+	struct Tensor {
+		TensorShape                  shape;
+		PI::DataType                 type;
+		std::string                  name;
+		bool                         hasData;
+		bool                         isVariable;
+		bool                         copied = false;
+	};
+
+// data
+	std::vector<PI::TensorId>                     inputs;
+	std::vector<PI::TensorId>                     outputs;
+	std::vector<Operator>                         operators;
+	std::vector<Tensor>                           tensors;
+
+public:
+	StructureCopy(const PluginInterface::Model *original);
+
+public: // interface implementation
+	unsigned                    numInputs() const override;
+	std::vector<PI::TensorId>   getInputs() const override;
+	unsigned                    numOutputs() const override;
+	std::vector<PI::TensorId>   getOutputs() const override;
+	unsigned                    numOperators() const override;
+	void                        getOperatorIo(unsigned operatorIdx, std::vector<PI::TensorId> &inputs, std::vector<PI::TensorId> &outputs) const override;
+	PI::OperatorKind            getOperatorKind(unsigned operatorIdx) const override;
+	PI::OperatorOptionsList*    getOperatorOptions(unsigned operatorIdx) const override;
+	unsigned                    numTensors() const override;
+	TensorShape                 getTensorShape(PI::TensorId tensorId) const override;
+	PI::DataType                getTensorType(PI::TensorId tensorId) const override;
+	std::string                 getTensorName(PI::TensorId tensorId) const override;
+	bool                        getTensorHasData(PI::TensorId tensorId) const override;
+	const void*                 getTensorData(PI::TensorId tensorId) const override;
+	const float*                getTensorDataF32(PI::TensorId tensorId) const override;
+	bool                        getTensorIsVariableFlag(PI::TensorId tensorId) const override;
+}; // StructureCopy
+
+} // ModelViews
@@ -0,0 +1,233 @@
+// Copyright (C) 2020 by Yuri Victorovich. All rights reserved.
+
+// nn-insight-client sends inference requests to nn-insight-serve, it is meant for testing and measuring the server
+
+#include "serve-protocol.h"
+#include "tensor.h"
+#include "misc.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <atomic>
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+
+static int connectToServer(const std::string &socketPath) {
+	struct sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	if (socketPath.size() >= sizeof(addr.sun_path))
+		FAIL("socket path '" << socketPath << "' is too long")
+	::strcpy(addr.sun_path, socketPath.c_str());
+	int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd == -1 || ::connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == -1)
+		FAIL("failed to connect to '" << socketPath << "': " << strerror(errno))
+	return fd;
+}
+
+static ServeProtocol::ResponseHeader response(int fd, std::vector<char> &payload) {
+	ServeProtocol::ResponseHeader rsp;
+	if (!ServeProtocol::readFully(fd, &rsp, sizeof(rsp)) || rsp.magic != ServeProtocol::Magic)
+		FAIL("failed to receive the response")
+	payload.resize(rsp.payloadSize);
+	if (!ServeProtocol::readFully(fd, payload.data(), payload.size()))
+		FAIL("failed to receive the response payload")
+	if (rsp.status != ServeProtocol::Status_Ok)
+		FAIL("server error: " << std::string(payload.begin(), payload.end()))
+	return rsp;
+}
+
+static ServeProtocol::ResponseHeader request(int fd, ServeProtocol::RequestKind kind, unsigned model, const TensorShape &shape, const float *data, std::vector<char> &payload) {
+	ServeProtocol::RequestHeader hdr = {};
+	hdr.magic = ServeProtocol::Magic;
+	hdr.kind = kind;
+	hdr.model = model;
+	hdr.shape = ServeProtocol::Shape::fromTensorShape(shape);
+	hdr.payloadSize = data ? Tensor::flatSize(shape)*sizeof(float) : 0;
+	if (!ServeProtocol::writeFully(fd, &hdr, sizeof(hdr)) || !ServeProtocol::writeFully(fd, data, hdr.payloadSize))
+		FAIL("failed to send the request: " << strerror(errno))
+	return response(fd, payload);
+}
+
+int main(int argc, char **argv) {
+	auto usage = []() {
+		FAIL("Usage: nn-insight-client [-m {model-index}] [-n {num-requests}] [-c {num-connections}] [-r] [-i {input-tensor.json}] {socket-path}\n"
+		     "       -r: pass data through a shared memory ring with {num-connections} slots over a single connection")
+	};
+
+	// arguments
+	unsigned model = 0;
+	unsigned numRequests = 100;
+	unsigned numConnections = 8;
+	bool useRing = false;
+	const char *inputFile = nullptr;
+	int opt;
+	while ((opt = ::getopt(argc, argv, "m:n:c:ri:")) != -1)
+		switch (opt) {
+		case 'm':
+			model = std::max(0, ::atoi(optarg));
+			break;
+		case 'n':
+			numRequests = std::max(1, ::atoi(optarg));
+			break;
+		case 'c':
+			numConnections = std::max(1, ::atoi(optarg));
+			break;
+		case 'r':
+			useRing = true;
+			break;
+		case 'i':
+			inputFile = optarg;
+			break;
+		default:
+			usage();
+		}
+	if (argc - optind != 1)
+		usage();
+	std::string socketPath = argv[optind];
+
+	// find the input and output shapes
+	TensorShape inputShape, outputShape;
+	{
+		int fd = connectToServer(socketPath);
+		std::vector<char> payload;
+		inputShape = request(fd, ServeProtocol::RequestKind_Info, model, TensorShape(), nullptr, payload).shape.toTensorShape();
+		if (payload.size() != sizeof(ServeProtocol::Shape))
+			FAIL("unexpected info response")
+		outputShape = reinterpret_cast<const ServeProtocol::Shape*>(payload.data())->toTensorShape();
+		::close(fd);
+	}
+	auto inputSize = Tensor::flatSize(inputShape)*sizeof(float);
+	auto outputSize = Tensor::flatSize(outputShape)*sizeof(float);
+
+	// input data: from the file saved by nn-insight, or a constant
+	std::shared_ptr<const float> input;
+	if (inputFile) {
+		if (!Tensor::readTensorDataAsJson(inputFile, inputShape, input))
+			FAIL("failed to read the input tensor of the shape " << inputShape << " from '" << inputFile << "'")
+	} else {
+		auto data = new float[Tensor::flatSize(inputShape)];
+		std::fill(data, data+Tensor::flatSize(inputShape), 0.5);
+		input.reset(data, std::default_delete<float[]>());
+	}
+
+	std::mutex lock;
+	std::vector<double> latencies; // ms
+	std::vector<float> firstOutput;
+	auto recordOutput = [&](std::chrono::steady_clock::time_point t, const void *output) {
+		std::unique_lock<std::mutex> l(lock);
+		latencies.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t).count());
+		if (firstOutput.empty()) {
+			firstOutput.resize(outputSize/sizeof(float));
+			::memcpy(firstOutput.data(), output, outputSize);
+		}
+	};
+	auto timeStart = std::chrono::steady_clock::now();
+
+	if (!useRing) {
+		// send requests concurrently over all connections
+		std::vector<std::thread> threads;
+		for (unsigned c = 0; c < numConnections; c++)
+			threads.emplace_back([&,c]() {
+				int fd = connectToServer(socketPath);
+				std::vector<char> output;
+				for (unsigned r = c; r < numRequests; r += numConnections) {
+					auto t = std::chrono::steady_clock::now();
+					request(fd, ServeProtocol::RequestKind_Infer, model, inputShape, input.get(), output);
+					if (output.size() != outputSize)
+						FAIL("unexpected output size " << output.size())
+					recordOutput(t, output.data());
+				}
+				::close(fd);
+			});
+		for (auto &t : threads)
+			t.join();
+	} else {
+		// create the ring and attach it
+		ServeProtocol::RingHeader hdr;
+		auto ringSize = ServeProtocol::ringLayout(numConnections, inputSize, outputSize, hdr);
+		int ringFd = ::memfd_create("nn-insight-ring", MFD_CLOEXEC);
+		if (ringFd == -1 || ::ftruncate(ringFd, ringSize) == -1)
+			FAIL("failed to create the ring: " << strerror(errno))
+		auto ring = ::mmap(nullptr, ringSize, PROT_READ|PROT_WRITE, MAP_SHARED, ringFd, 0);
+		if (ring == MAP_FAILED)
+			FAIL("failed to map the ring: " << strerror(errno))
+		*static_cast<ServeProtocol::RingHeader*>(ring) = hdr; // slots are zeroed by ftruncate, i.e. SlotState_Free
+		int submittedFd = ::eventfd(0, EFD_CLOEXEC);
+		int completedFd = ::eventfd(0, EFD_CLOEXEC);
+		if (submittedFd == -1 || completedFd == -1)
+			FAIL("failed to create eventfds: " << strerror(errno))
+
+		int fd = connectToServer(socketPath);
+		ServeProtocol::RequestHeader attach = {};
+		attach.magic = ServeProtocol::Magic;
+		attach.kind = ServeProtocol::RequestKind_AttachRing;
+		attach.model = model;
+		int fds[3] = {ringFd, submittedFd, completedFd};
+		if (!ServeProtocol::writeFully(fd, &attach, sizeof(attach)) || !ServeProtocol::sendFds(fd, fds, 3))
+			FAIL("failed to attach the ring: " << strerror(errno))
+		std::vector<char> payload;
+		response(fd, payload);
+		::close(ringFd);
+
+		// keep all slots busy: inputs are written directly into the slots, outputs are read in place
+		auto slotState = [&](unsigned s) -> std::atomic<uint32_t>& {
+			return reinterpret_cast<ServeProtocol::RingSlot*>(ServeProtocol::ringSlot(ring, hdr, s))->state;
+		};
+		std::vector<std::chrono::steady_clock::time_point> submitTimes(hdr.numSlots);
+		unsigned numSubmitted = 0, numCompleted = 0;
+		while (numCompleted < numRequests) {
+			bool submitted = false;
+			for (unsigned s = 0; s < hdr.numSlots && numSubmitted < numRequests; s++)
+				if (slotState(s).load(std::memory_order_acquire) == ServeProtocol::SlotState_Free) {
+					::memcpy(ServeProtocol::ringSlot(ring, hdr, s) + hdr.inputOffset, input.get(), inputSize);
+					submitTimes[s] = std::chrono::steady_clock::now();
+					slotState(s).store(ServeProtocol::SlotState_Submitted, std::memory_order_release);
+					numSubmitted++;
+					submitted = true;
+				}
+			uint64_t cnt = 1;
+			if (submitted && ::write(submittedFd, &cnt, sizeof(cnt)) != sizeof(cnt))
+				FAIL("failed to signal the ring: " << strerror(errno))
+			if (::read(completedFd, &cnt, sizeof(cnt)) != sizeof(cnt))
+				FAIL("failed to wait for the ring: " << strerror(errno))
+			for (unsigned s = 0; s < hdr.numSlots; s++)
+				if (slotState(s).load(std::memory_order_acquire) == ServeProtocol::SlotState_Done) {
+					auto slot = ServeProtocol::ringSlot(ring, hdr, s);
+					auto &rs = *reinterpret_cast<const ServeProtocol::RingSlot*>(slot);
+					if (rs.status != ServeProtocol::Status_Ok)
+						FAIL("server error: " << std::string((const char*)slot + hdr.outputOffset, rs.outputSize))
+					recordOutput(submitTimes[s], slot + hdr.outputOffset);
+					slotState(s).store(ServeProtocol::SlotState_Free, std::memory_order_release);
+					numCompleted++;
+				}
+		}
+
+		::close(fd);
+		::close(submittedFd);
+		::close(completedFd);
+		::munmap(ring, ringSize);
+	}
+	auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - timeStart).count();
+
+	// report
+	std::sort(latencies.begin(), latencies.end());
+	auto argMax = std::max_element(firstOutput.begin(), firstOutput.end()) - firstOutput.begin();
+	PRINT("output: " << firstOutput.size() << " values, the largest value " << firstOutput[argMax] << " is at index " << argMax)
+	PRINT(numRequests << " requests " << (useRing ? "through a ring with " : "over ") << numConnections << (useRing ? " slots" : " connections")
+		<< " in " << elapsed << " s: " << numRequests/elapsed << " requests/s")
+	PRINT("latency: median " << latencies[latencies.size()/2] << " ms, max " << latencies.back() << " ms")
+
+	return 0;
+}
@@ -0,0 +1,429 @@
+// Copyright (C) 2020 by Yuri Victorovich. All rights reserved.
+
+// nn-insight-eval runs the model on a sequence of images: decoding, preprocessing, computation and interpretation of outputs
+// run as concurrent pipeline stages, the per-stage counters show which stage limits the throughput;
+// with a labeled dataset directory it measures the accuracy of the model, results are accumulated as they arrive so the dataset size doesn't matter
+
+#include "pipeline.h"
+#include "model-registry.h"
+#include "compute.h"
+#include "image.h"
+#include "model-functions.h"
+#include "tensor.h"
+#include "tensor-data.h"
+#include "tensor-pool.h"
+#include "nn-types.h"
+#include "parallel.h"
+#include "misc.h"
+#include "util.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <array>
+#include <memory>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <algorithm>
+#include <exception>
+#include <filesystem>
+#include <cctype>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef PluginInterface PI;
+
+// the item passed through the stages
+struct Frame {
+	unsigned                                 index;
+	std::string                              fileName;
+	std::shared_ptr<float>                   image;
+	TensorShape                              imageShape;
+	std::map<PI::TensorId, TensorData>       inputs;
+	std::unique_ptr<std::vector<TensorData>> tensorData;
+	int                                      truth = -1; // the true class when evaluating over a dataset
+	std::vector<std::pair<unsigned,float>>   top; // (class, score) in the order of decreasing scores
+	std::string                              error;
+};
+
+static bool parseInputNormalizationRange(const char *str, InputNormalizationRange &range) {
+	static const std::map<std::string, InputNormalizationRange> names = {
+		{"0..1",       InputNormalizationRange_0_1},
+		{"0..255",     InputNormalizationRange_0_255},
+		{"0..128",     InputNormalizationRange_0_128},
+		{"0..64",      InputNormalizationRange_0_64},
+		{"0..32",      InputNormalizationRange_0_32},
+		{"0..16",      InputNormalizationRange_0_16},
+		{"0..8",       InputNormalizationRange_0_8},
+		{"-1..1",      InputNormalizationRange_M1_P1},
+		{"-0.5..0.5",  InputNormalizationRange_M05_P05},
+		{"0.25..0.75", InputNormalizationRange_14_34},
+		{"imagenet",   InputNormalizationRange_ImageNet}
+	};
+	auto it = names.find(str);
+	if (it == names.end())
+		return false;
+	range = it->second;
+	return true;
+}
+
+static std::vector<std::string> readLines(const char *fileName) {
+	std::ifstream file(fileName);
+	if (!file.good())
+		FAIL("failed to open the file '" << fileName << "'")
+	std::vector<std::string> lines;
+	for (std::string line; std::getline(file, line);)
+		if (!line.empty())
+			lines.push_back(line);
+	return lines;
+}
+
+static std::string normalizeLabel(const std::string &label) {
+	std::string s;
+	for (auto c : label)
+		s += c == '_' ? ' ' : std::tolower(c);
+	auto b = s.find_first_not_of(' '), e = s.find_last_not_of(' ');
+	return b == std::string::npos ? "" : s.substr(b, e-b+1);
+}
+
+// maps class directory names to class indexes: the name is either the index itself, or any of the comma-separated names in the label
+static int findClass(const std::string &dirName, const std::vector<std::string> &labels, unsigned labelOffset, unsigned numClasses) {
+	char *end = nullptr;
+	auto idx = ::strtol(dirName.c_str(), &end, 10);
+	if (!dirName.empty() && *end == 0)
+		return idx >= 0 && idx < numClasses ? idx : -1;
+	auto name = normalizeLabel(dirName);
+	for (unsigned l = labelOffset; l < labels.size() && l-labelOffset < numClasses; l++) {
+		auto label = labels[l];
+		for (size_t b = 0, e; b != std::string::npos; b = e == std::string::npos ? e : e+1) {
+			e = label.find(',', b);
+			if (normalizeLabel(label.substr(b, e == std::string::npos ? e : e-b)) == name)
+				return l-labelOffset;
+		}
+		if (normalizeLabel(label) == name)
+			return l-labelOffset;
+	}
+	return -1;
+}
+
+int main(int argc, char **argv) {
+	auto usage = []() {
+		FAIL("Usage: nn-insight-eval [-n {input-normalization}] [-b] [-k {top-k}] [-L {labels.txt}] [-j {compute-threads}] [-q {queue-size}] [-C {confusion.csv}]"
+		     " {network.tflite} {image.png ...|-i {image-list.txt}|-d {dataset-dir}}\n"
+		     "       input normalization is one of 0..1 (default), 0..255, 0..128, 0..64, 0..32, 0..16, 0..8, -1..1, -0.5..0.5, 0.25..0.75, imagenet\n"
+		     "       -b: BGR color order\n"
+		     "       -d: evaluate the accuracy over images in {dataset-dir}/{class}/, where {class} is the class index or one of its label names,\n"
+		     "           ImageNet labels are used by default for ImageNet-like outputs\n"
+		     "       -C: save the confusion counts as (true class, predicted class, count) rows")
+	};
+
+	// arguments
+	InputNormalization inputNormalization = {InputNormalizationRange_0_1, InputNormalizationColorOrder_RGB};
+	unsigned topK = 5;
+	const char *labelsFile = nullptr;
+	const char *imageListFile = nullptr;
+	const char *datasetDir = nullptr;
+	const char *confusionFile = nullptr;
+	unsigned numComputeThreads = std::max(1u, Parallel::numThreads()/2); // kernels are parallel themselves
+	unsigned queueSize = 4;
+	int opt;
+	while ((opt = ::getopt(argc, argv, "n:bk:L:i:d:C:j:q:")) != -1)
+		switch (opt) {
+		case 'n':
+			if (!parseInputNormalizationRange(optarg, std::get<0>(inputNormalization)))
+				usage();
+			break;
+		case 'b':
+			std::get<1>(inputNormalization) = InputNormalizationColorOrder_BGR;
+			break;
+		case 'k':
+			topK = std::max(1, ::atoi(optarg));
+			break;
+		case 'L':
+			labelsFile = optarg;
+			break;
+		case 'i':
+			imageListFile = optarg;
+			break;
+		case 'd':
+			datasetDir = optarg;
+			break;
+		case 'C':
+			confusionFile = optarg;
+			break;
+		case 'j':
+			numComputeThreads = std::max(1, ::atoi(optarg));
+			break;
+		case 'q':
+			queueSize = std::max(1, ::atoi(optarg));
+			break;
+		default:
+			usage();
+		}
+	if (imageListFile && datasetDir)
+		usage();
+	if (imageListFile || datasetDir ? argc - optind != 1 : argc - optind < 2)
+		usage();
+	if (confusionFile && !datasetDir)
+		usage();
+	std::string modelFileName = argv[optind];
+	std::vector<std::string> imageFileNames = imageListFile ? readLines(imageListFile) : std::vector<std::string>(argv+optind+1, argv+argc);
+
+	// load the model
+	ModelRegistry registry(0/*no memory cap*/, ""/*no weights cache*/);
+	std::string error;
+	auto model = registry.acquire(modelFileName, error);
+	if (!model)
+		FAIL(error)
+	if (model->getInputs().size() != 1)
+		FAIL("only models with a single input are supported, the model '" << modelFileName << "' has " << model->getInputs().size() << " inputs")
+	auto outputTensorId = model->getOutputs()[0];
+	auto tensorPool = std::make_shared<TensorPool>();
+
+	// labels: output index i has the label labels[labelOffset+i]
+	std::vector<std::string> labels;
+	unsigned labelOffset = 0;
+	auto numClasses = (unsigned)Tensor::flatSize(model->getTensorShape(outputTensorId));
+	if (labelsFile)
+		labels = readLines(labelsFile);
+	else switch (ModelFunctions::guessOutputInterpretationKind(model.get())) {
+	case OutputInterpretationKind_ImageNet1000:
+	case OutputInterpretationKind_ImageNet1001:
+		for (auto &label : Util::readListFromFile(":/nn-labels/imagenet-labels.txt"))
+			labels.push_back(Q2S(label));
+		labelOffset = numClasses == 1000 ? 1 : 0; // skip the first label of 1001 labels when count=1000
+		break;
+	default:
+		break;
+	}
+	auto labelOf = [&labels,labelOffset](unsigned cls) -> std::string {
+		return labelOffset+cls < labels.size() ? labels[labelOffset+cls] : "";
+	};
+
+	// dataset: files are found as the source asks for them, class directories are matched once
+	std::unique_ptr<std::filesystem::recursive_directory_iterator> datasetIterator;
+	std::map<std::string, int> datasetClasses;
+	std::error_code ec; // unreadable directories are skipped
+	if (datasetDir) {
+		if (!labelsFile && labels.empty())
+			WARNING("no labels for the model '" << modelFileName << "', class directories have to be named by class indexes")
+		datasetIterator.reset(new std::filesystem::recursive_directory_iterator(datasetDir, ec));
+		if (ec)
+			FAIL("failed to open the dataset directory '" << datasetDir << "': " << ec.message())
+		topK = std::max(topK, 5u);
+	}
+
+	// stages
+	Pipeline<Frame> pipeline(queueSize);
+	pipeline.addStage("decode", 2, [](Frame &frame) {
+		try {
+			frame.image.reset(Image::readPngImageFile(frame.fileName, frame.imageShape), std::default_delete<float[]>());
+		} catch (const std::exception &e) {
+			frame.error = STR("failed to read the image: " << e.what());
+		}
+		return true;
+	});
+	pipeline.addStage("preprocess", 2, [&model,&inputNormalization](Frame &frame) {
+		if (!frame.error.empty())
+			return true;
+		auto cbWarningMessage = [&frame](const std::string &msg) {frame.error = msg;};
+		if (!Compute::buildComputeInputs(model.get(),
+			std::array<unsigned,4>{0,0, frame.imageShape[1]-1,frame.imageShape[0]-1}, inputNormalization,
+			frame.image, frame.imageShape,
+			frame.inputs,
+			[](PI::TensorId) { }, cbWarningMessage) && frame.error.empty())
+		{
+			frame.error = "couldn't prepare the input";
+		}
+		frame.image.reset(); // not needed any more
+		return true;
+	});
+	pipeline.addStage("compute", numComputeThreads, [&model,&tensorPool,outputTensorId](Frame &frame) {
+		if (!frame.error.empty())
+			return true;
+		frame.tensorData.reset(new std::vector<TensorData>(model->numTensors()));
+		Compute::fillInputs(frame.inputs, frame.tensorData);
+		frame.inputs.clear();
+		auto &tensorData = frame.tensorData;
+		if (!Compute::compute(model.get(), tensorData,
+			[](PI::TensorId) { },
+			[&frame](const std::string &msg) {frame.error = msg;},
+			[&tensorData](PI::TensorId tensorId) {(*tensorData)[tensorId].reset();}, // return intermediate buffers to the pool as soon as possible
+			tensorPool.get(),
+			{outputTensorId}) && frame.error.empty())
+		{
+			frame.error = "computation failed";
+		}
+		return true;
+	});
+	pipeline.addStage("interpret", 1, [outputTensorId,topK](Frame &frame) {
+		if (!frame.error.empty())
+			return true;
+		auto output = (*frame.tensorData)[outputTensorId].toFloat32();
+		auto data = output.get();
+		std::vector<std::pair<unsigned,float>> scores;
+		for (unsigned i = 0, ie = output.numElements(); i < ie; i++)
+			scores.push_back({i, data[i]});
+		auto k = std::min<size_t>(topK, scores.size());
+		std::partial_sort(scores.begin(), scores.begin()+k, scores.end(), [](auto &a, auto &b) {return a.second > b.second;});
+		scores.resize(k);
+		frame.top = std::move(scores);
+		frame.tensorData.reset(); // outputs go back to the pool
+		return true;
+	});
+
+	// accuracy counters
+	struct ClassCounts {
+		size_t                   numImages = 0;
+		size_t                   numTop1 = 0;
+		size_t                   numTop5 = 0;
+		std::map<unsigned,size_t> predicted; // sparse row of the confusion matrix
+	};
+	std::map<unsigned, ClassCounts> classCounts;
+	size_t numTop1 = 0, numTop5 = 0, numEvaluated = 0;
+
+	// run
+	unsigned next = 0;
+	unsigned numImages = 0;
+	unsigned numErrors = 0;
+	auto timeStart = std::chrono::steady_clock::now();
+	auto secondsSince = [](std::chrono::steady_clock::time_point t) {
+		return std::chrono::duration<float>(std::chrono::steady_clock::now() - t).count();
+	};
+	auto percent = [](size_t n, size_t total) {
+		return total ? 100.*n/total : 0.;
+	};
+	pipeline.run(
+		[&](Frame &frame) {
+			if (!datasetIterator) {
+				if (next == imageFileNames.size())
+					return false;
+				frame.index = next;
+				frame.fileName = imageFileNames[next++];
+				return true;
+			}
+			for (auto &it = *datasetIterator; it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+				if (!it->is_regular_file(ec) || it.depth() == 0 || it->path().extension() != ".png")
+					continue;
+				auto classDir = std::filesystem::relative(it->path(), datasetDir).begin()->string();
+				auto cls = datasetClasses.find(classDir);
+				if (cls == datasetClasses.end()) {
+					cls = datasetClasses.insert({classDir, findClass(classDir, labels, labelOffset, numClasses)}).first;
+					if (cls->second == -1)
+						WARNING("skipping the directory '" << classDir << "' that doesn't match any class")
+				}
+				if (cls->second == -1)
+					continue;
+				frame.index = next++;
+				frame.fileName = it->path().string();
+				frame.truth = cls->second;
+				it.increment(ec);
+				return true;
+			}
+			return false;
+		},
+		[&](Frame &frame) {
+			numImages++;
+			std::cout << frame.index << " " << frame.fileName << ":";
+			if (!frame.error.empty()) {
+				std::cout << " ERROR " << frame.error;
+				numErrors++;
+			}
+			for (auto &t : frame.top) {
+				std::cout << " " << t.first;
+				auto label = labelOf(t.first);
+				if (!label.empty())
+					std::cout << " (" << label << ")";
+				std::cout << "=" << t.second;
+			}
+			std::cout << std::endl;
+
+			// accumulate
+			if (frame.truth == -1 || frame.top.empty())
+				return;
+			auto &counts = classCounts[frame.truth];
+			counts.numImages++;
+			numEvaluated++;
+			if (frame.top[0].first == (unsigned)frame.truth) {
+				counts.numTop1++;
+				numTop1++;
+			}
+			for (unsigned i = 0; i < 5 && i < frame.top.size(); i++)
+				if (frame.top[i].first == (unsigned)frame.truth) {
+					counts.numTop5++;
+					numTop5++;
+					break;
+				}
+			counts.predicted[frame.top[0].first]++;
+			if (numEvaluated % 1000 == 0)
+				std::cerr << numEvaluated << " images: top-1 " << percent(numTop1, numEvaluated) << "%, top-5 " << percent(numTop5, numEvaluated) << "%, "
+				          << numImages/secondsSince(timeStart) << " images/s" << std::endl;
+		}
+	);
+	auto elapsed = secondsSince(timeStart);
+
+	// report stage counters: the stage with the highest utilization is the bottleneck
+	std::cerr << numImages << " images in " << elapsed << " s: " << numImages/elapsed << " images/s, " << numErrors << " errors" << std::endl;
+	for (auto &s : pipeline.getStats())
+		std::cerr << "  " << std::left << std::setw(12) << s.name << std::right
+		          << " threads=" << s.numThreads
+		          << " items=" << s.numItems
+		          << " busy=" << s.busySeconds << "s"
+		          << " utilization=" << std::setprecision(3) << 100*s.busySeconds/(s.numThreads*elapsed) << "%"
+		          << " waiting for input=" << s.inputWaitSeconds << "s"
+		          << " for output=" << s.outputWaitSeconds << "s"
+		          << std::setprecision(6) << std::endl;
+
+	// report accuracy
+	if (datasetDir) {
+		if (numEvaluated == 0)
+			FAIL("no images were evaluated: the dataset directory '" << datasetDir << "' should have subdirectories named after classes with .png images in them")
+		auto className = [&](unsigned cls) {
+			auto label = labelOf(cls);
+			return label.empty() ? STR(cls) : STR(cls << " (" << label << ")");
+		};
+		std::cerr << "accuracy over " << numEvaluated << " images in " << classCounts.size() << " classes:"
+		          << " top-1 " << percent(numTop1, numEvaluated) << "%, top-5 " << percent(numTop5, numEvaluated) << "%" << std::endl;
+
+		// least accurate classes and most frequent confusions
+		std::vector<std::pair<unsigned,float>> classAccuracy;
+		std::vector<std::tuple<unsigned,unsigned,size_t>> confusions;
+		for (auto &c : classCounts) {
+			classAccuracy.push_back({c.first, percent(c.second.numTop1, c.second.numImages)});
+			for (auto &p : c.second.predicted)
+				if (p.first != c.first)
+					confusions.push_back({c.first, p.first, p.second});
+		}
+		auto nWorst = std::min<size_t>(10, classAccuracy.size());
+		std::partial_sort(classAccuracy.begin(), classAccuracy.begin()+nWorst, classAccuracy.end(), [](auto &a, auto &b) {return a.second < b.second;});
+		std::cerr << "least accurate classes:" << std::endl;
+		for (unsigned i = 0; i < nWorst; i++) {
+			auto &c = classCounts[classAccuracy[i].first];
+			std::cerr << "  " << className(classAccuracy[i].first) << ": top-1 " << classAccuracy[i].second << "%"
+			          << ", top-5 " << percent(c.numTop5, c.numImages) << "% of " << c.numImages << " images" << std::endl;
+		}
+		auto nConfused = std::min<size_t>(10, confusions.size());
+		std::partial_sort(confusions.begin(), confusions.begin()+nConfused, confusions.end(), [](auto &a, auto &b) {return std::get<2>(a) > std::get<2>(b);});
+		std::cerr << "most frequent confusions:" << std::endl;
+		for (unsigned i = 0; i < nConfused; i++)
+			std::cerr << "  " << className(std::get<0>(confusions[i])) << " taken for " << className(std::get<1>(confusions[i])) << ": "
+			          << std::get<2>(confusions[i]) << " times" << std::endl;
+
+		// confusion matrix
+		if (confusionFile) {
+			std::ofstream file(confusionFile);
+			if (!file.good())
+				FAIL("failed to create the file '" << confusionFile << "'")
+			file << "true,predicted,count" << std::endl;
+			for (auto &c : classCounts)
+				for (auto &p : c.second.predicted)
+					file << c.first << "," << p.first << "," << p.second << std::endl;
+		}
+	}
+
+	return numErrors == 0 ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+// Copyright (C) 2020 by Yuri Victorovich. All rights reserved.
+
+#include "inference-server.h"
+#include "model-registry.h"
+#include "misc.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <algorithm>
+
+#include <stdlib.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+
+int main(int argc, char **argv) {
+	// signals are only received by the main thread: block them before any other thread is started, the model registry starts its watch thread
+	sigset_t signals;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+	signal(SIGPIPE, SIG_IGN); // clients can disconnect at any time
+
+	auto usage = []() {
+		FAIL("Usage: nn-insight-serve [-b {max-batch-size}] [-l {max-latency-ms}] [-m {memory-cap-MB}] [-w {weights-cache-dir}] {socket-path} {network.tflite} [{network.tflite} ...]\n"
+		     "       requests refer to networks by their index in the list, networks are loaded on demand and unloaded beyond the memory cap,\n"
+		     "       derived weights are kept in the weights cache directory where all servers share them")
+	};
+
+	// arguments
+	InferenceServer::Options options = {8/*maxBatchSize*/, 5000/*maxLatencyUs*/};
+	size_t memoryCap = 0;
+	std::string weightsCacheDir;
+	int opt;
+	while ((opt = ::getopt(argc, argv, "b:l:m:w:")) != -1)
+		switch (opt) {
+		case 'b':
+			options.maxBatchSize = std::max(1, ::atoi(optarg));
+			break;
+		case 'l':
+			options.maxLatencyUs = ::atof(optarg)*1000;
+			break;
+		case 'm':
+			memoryCap = size_t(::atof(optarg)*1024*1024);
+			break;
+		case 'w':
+			weightsCacheDir = optarg;
+			break;
+		default:
+			usage();
+		}
+	if (argc - optind < 2)
+		usage();
+	std::string socketPath = argv[optind];
+	std::vector<std::string> modelPaths(argv+optind+1, argv+argc);
+
+	// check that all models can be loaded, they remain loaded as long as they fit within the memory cap
+	ModelRegistry registry(memoryCap, weightsCacheDir);
+	for (auto &modelPath : modelPaths) {
+		std::string error;
+		auto model = registry.acquire(modelPath, error);
+		if (!model)
+			FAIL(error)
+		if (model->getInputs().size() != 1)
+			FAIL("only models with a single input can be served, the model '" << modelPath << "' has " << model->getInputs().size() << " inputs")
+	}
+
+	// serve
+	{
+		InferenceServer server(registry, modelPaths, options);
+		if (!server.listen(socketPath))
+			return 1;
+		for (unsigned m = 0; m < modelPaths.size(); m++)
+			PRINT("model #" << m << ": '" << modelPaths[m] << "'")
+		PRINT("serving " << modelPaths.size() << " model(s) on '" << socketPath << "' with batches of up to " << options.maxBatchSize
+			<< " requests within " << options.maxLatencyUs << " us")
+		std::thread serverThread(&InferenceServer::run, &server);
+
+		int sig = 0;
+		sigwait(&signals, &sig);
+		PRINT("stopping on signal " << sig)
+		server.stop();
+		serverThread.join();
+
+		auto stats = server.getStats();
+		PRINT("served " << stats.numRequests << " requests in " << stats.numBatches << " batches"
+			<< " (" << (stats.numBatches ? float(stats.numRequests)/stats.numBatches : 0) << " per batch), " << stats.numErrors << " errors")
+		auto registryStats = registry.getStats();
+		PRINT("models: " << registryStats.numLoads << " loads, " << registryStats.numEvictions << " evictions, " << registryStats.numReloads << " reloads, "
+			<< registryStats.numResident << " resident using " << registryStats.memoryUse/1024/1024 << " MB")
+	}
+
+	return 0;
+}
@@ -45,6 +45,17 @@ enum OutputInterpretationKind {
 	OutputInterpretationKind_ImageConversion
 };
 
+enum ActivationStorage { // how computed tensors are kept after they were consumed by the computation
+	ActivationStorage_Float32,
+	ActivationStorage_Float16,
+	ActivationStorage_BFloat16
+};
+
+enum MemoryBudgetPolicy { // what happens to intermediate tensors beyond the memory budget
+	MemoryBudgetPolicy_Recompute, // they are released and recomputed when inspected
+	MemoryBudgetPolicy_Spill      // they are moved to scratch files and are paged in when inspected
+};
+
 typedef std::tuple<InputNormalizationRange,InputNormalizationColorOrder> InputNormalization;
 
 // based on ComputePaddingWithOffset from the TF Lite project in order to match the results
@@ -1,36 +1,81 @@
 // Copyright (C) 2020 by Yuri Victorovich. All rights reserved.
 
 #include "nn-widget.h"
-#include "svg-graphics-generator.h"
+#include "model-scene.h"
+#include "model-views/structure-copy.h"
 
 #include <QMouseEvent>
-#include <QByteArray>
+#include <QEvent>
+#include <QPainter>
+#include <QPen>
+#include <QMetaObject>
+#include <QApplication>
 
+#include <memory>
+#include <algorithm>
+
+// options
+static const QColor clrHovered     = QColor(255,165,0);
+static const QColor clrSelected    = QColor(30,144,255);
+static const QColor clrRubberBand  = QColor(30,144,255,40);
+
+/// constructor
 
 NnWidget::NnWidget(QWidget *parent)
 : ZoomableSvgWidget(parent)
 , model(nullptr)
+, hoveredItem(-1)
+, rubberBanding(false)
+, layoutGeneration(0)
 {
+	setMouseTracking(true); // for hovering
+}
+
+NnWidget::~NnWidget() {
+	for (auto &t : layoutThreads) // they post results to the widget
+		t.second.join();
 }
 
 /// interface
 
 void NnWidget::open(const PluginInterface::Model *model_) {
-	load(SvgGraphics::generateModelSvg(model_,
-		{&modelIndexes.allOperatorBoxes, &modelIndexes.allTensorLabelBoxes, &modelIndexes.allInputBoxes, &modelIndexes.allOutputBoxes}));
+	// the linear layout is shown right away
 	model = model_;
+	setScene(ModelScene::generate(model_, true/*linearLayout*/));
+
+	// the Graphviz layout replaces it when it is ready: it is computed from the copy of the model structure
+	// because the model can be closed before it is finished, and then its result is dropped
+	auto generation = ++layoutGeneration;
+	auto structure = std::make_shared<const ModelViews::StructureCopy>(model_);
+	layoutThreads[generation] = std::thread([this,structure,generation]() {
+		auto scene = ModelScene::generate(structure.get(), false/*linearLayout*/);
+		QMetaObject::invokeMethod(this, [this,generation,scene]() {
+			auto it = layoutThreads.find(generation);
+			it->second.join(); // it has nothing else to do
+			layoutThreads.erase(it);
+			if (generation != layoutGeneration)
+				return; // the model was closed or another one was opened since
+			setScene(scene);
+		}, Qt::QueuedConnection);
+	});
 }
 
 void NnWidget::close() {
-	clearIndices();
+	layoutGeneration++; // the layout that is still being computed is stale now
 	model = nullptr;
-	load(QByteArray());
-	resize(0,0);
+	setScene(nullptr);
 }
 
 /// overridden
 
 void NnWidget::mousePressEvent(QMouseEvent *event) {
+	// rubber band
+	if (model && event->button() == Qt::LeftButton && (QApplication::keyboardModifiers()&Qt::ShiftModifier)) {
+		rubberBanding = true;
+		rubberBandStart = rubberBandEnd = event->pos()/getScalingFactor();
+		return; // no panning
+	}
+
 	if (model) {
 		auto searchResult = findObjectAtThePoint(event->pos());
 		if (searchResult.operatorId != -1)
@@ -49,38 +94,155 @@ void NnWidget::mousePressEvent(QMouseEvent *event) {
 	ZoomableSvgWidget::mousePressEvent(event);
 }
 
-/// internals
+void NnWidget::mouseMoveEvent(QMouseEvent *event) {
+	if (rubberBanding) {
+		auto rectOld = QRectF(rubberBandStart, rubberBandEnd).normalized();
+		rubberBandEnd = event->pos()/getScalingFactor();
+		updateContentRect(rectOld.united(QRectF(rubberBandStart, rubberBandEnd).normalized()));
+		return;
+	}
+
+	if (model)
+		setHoveredItem(findItemAtThePoint(event->pos()));
 
-void NnWidget::clearIndices() {
-	for (auto index : {&modelIndexes.allOperatorBoxes,&modelIndexes.allTensorLabelBoxes,&modelIndexes.allInputBoxes,&modelIndexes.allOutputBoxes})
-		index->clear();
+	// pass
+	ZoomableSvgWidget::mouseMoveEvent(event);
 }
 
-NnWidget::AnyObject NnWidget::findObjectAtThePoint(const QPointF &pt) const {
-	const QPointF pts = pt/getScalingFactor();
-	
-	// XXX ad hoc algorithm until we find some good geoindexing implementation
+void NnWidget::mouseReleaseEvent(QMouseEvent *event) {
+	if (rubberBanding) {
+		rubberBanding = false;
+		auto rect = QRectF(rubberBandStart, rubberBandEnd).normalized();
+
+		// select boxes that intersect the band
+		for (auto idx : selectedItems)
+			updateContentRect(scene->getItem(idx).rect);
+		selectedItems.clear();
+		std::vector<PluginInterface::OperatorId> oids;
+		scene->forEachItemIn(rect, [&](unsigned idx) {
+			auto &item = scene->getItem(idx);
+			if (item.kind == ModelScene::ItemKind_Operator || item.kind == ModelScene::ItemKind_Input || item.kind == ModelScene::ItemKind_Output)
+				selectedItems.push_back(idx);
+			if (item.kind == ModelScene::ItemKind_Operator)
+				oids.push_back(item.id);
+		});
+		std::sort(oids.begin(), oids.end());
+		updateContentRect(rect);
+		for (auto idx : selectedItems)
+			updateContentRect(scene->getItem(idx).rect);
+
+		emit selectedOperators(oids);
+		return;
+	}
+
+	// pass
+	ZoomableSvgWidget::mouseReleaseEvent(event);
+}
+
+void NnWidget::leaveEvent(QEvent *event) {
+	setHoveredItem(-1);
+
+	// pass
+	ZoomableSvgWidget::leaveEvent(event);
+}
+
+QSizeF NnWidget::getContentSize() const {
+	return scene ? scene->getSize() : QSizeF();
+}
+
+TileCache::ContentPainter NnWidget::getContentPainter() const {
+	auto scene = this->scene; // tiles paint the scene that was current when they were requested
+	return [scene](QPainter &painter, const QRectF &rect, qreal scale) {
+		if (scene)
+			scene->paint(painter, rect, scale);
+	};
+}
+
+void NnWidget::paintOverlay(QPainter &painter) const {
+	auto scale = getScalingFactor();
+	auto highlight = [&](unsigned idx, QColor color) {
+		painter.setPen(QPen(color, 3/scale));
+		painter.setBrush(Qt::NoBrush);
+		painter.drawRect(scene->getItem(idx).rect.adjusted(-2,-2, 2,2));
+	};
+
+	for (auto idx : selectedItems)
+		highlight(idx, clrSelected);
+	if (hoveredItem != -1)
+		highlight(hoveredItem, clrHovered);
+	if (rubberBanding) {
+		painter.setPen(QPen(clrSelected, 1/scale, Qt::DashLine));
+		painter.setBrush(clrRubberBand);
+		painter.drawRect(QRectF(rubberBandStart, rubberBandEnd).normalized());
+	}
+}
 
-	// operator box?
-	for (PluginInterface::OperatorId oid = 0, oide = modelIndexes.allOperatorBoxes.size(); oid < oide; oid++)
-		if (modelIndexes.allOperatorBoxes[oid].contains(pts))
-			return {(int)oid,-1,-1,-1};
+/// internals
 
-	// tensor label?
-	for (PluginInterface::TensorId tid = 0, tide = modelIndexes.allTensorLabelBoxes.size(); tid < tide; tid++)
-		if (modelIndexes.allTensorLabelBoxes[tid].contains(pts))
-			return {-1,(int)tid,-1,-1};
+void NnWidget::setScene(std::shared_ptr<const ModelScene> scene_) {
+	scene = scene_;
+	hoveredItem = -1; // items of the previous scene
+	selectedItems.clear();
+	rubberBanding = false;
+	contentChanged();
+}
 
-	// input box?
-	for (unsigned idx = 0, idxe = modelIndexes.allInputBoxes.size(); idx < idxe; idx++)
-		if (modelIndexes.allInputBoxes[idx].contains(pts))
-			return {-1,-1,(int)model->getInputs()[idx],-1};
+int NnWidget::findItemAtThePoint(const QPointF &pt) const {
+	if (!scene)
+		return -1;
+	const QPointF pts = pt/getScalingFactor();
 
-	// output box?
-	for (unsigned idx = 0, idxe = modelIndexes.allOutputBoxes.size(); idx < idxe; idx++)
-		if (modelIndexes.allOutputBoxes[idx].contains(pts))
-			return {-1,-1,-1,(int)model->getOutputs()[idx]};
+	// operators are preferred to tensor labels, and tensor labels to inputs and outputs
+	auto priority = [](ModelScene::ItemKind kind) {
+		switch (kind) {
+		case ModelScene::ItemKind_Operator:    return 0;
+		case ModelScene::ItemKind_TensorLabel: return 1;
+		case ModelScene::ItemKind_Input:       return 2;
+		case ModelScene::ItemKind_Output:      return 3;
+		default:                               return -1; // lines can't be clicked on
+		}
+	};
+	int found = -1;
+	scene->forEachItemIn(QRectF(pts, QSizeF(0,0)), [&](unsigned idx) {
+		auto &item = scene->getItem(idx);
+		if (priority(item.kind) == -1 || !item.rect.contains(pts))
+			return;
+		if (found == -1 || priority(item.kind) < priority(scene->getItem(found).kind))
+			found = idx;
+	});
+	return found;
+}
 
-	return {-1,-1,-1,-1}; // not found
+NnWidget::AnyObject NnWidget::findObjectAtThePoint(const QPointF &pt) const {
+	auto idx = findItemAtThePoint(pt);
+	if (idx == -1)
+		return {-1,-1,-1,-1}; // not found
+	auto &item = scene->getItem(idx);
+	switch (item.kind) {
+	case ModelScene::ItemKind_Operator:
+		return {(int)item.id,-1,-1,-1};
+	case ModelScene::ItemKind_TensorLabel:
+		return {-1,(int)item.id,-1,-1};
+	case ModelScene::ItemKind_Input:
+		return {-1,-1,(int)item.id,-1};
+	case ModelScene::ItemKind_Output:
+		return {-1,-1,-1,(int)item.id};
+	default:
+		return {-1,-1,-1,-1};
+	}
+}
+
+void NnWidget::setHoveredItem(int item) {
+	if (item == hoveredItem)
+		return;
+	if (hoveredItem != -1)
+		updateContentRect(scene->getItem(hoveredItem).rect);
+	hoveredItem = item;
+	if (hoveredItem != -1)
+		updateContentRect(scene->getItem(hoveredItem).rect);
 }
 
+void NnWidget::updateContentRect(const QRectF &rect) {
+	auto scale = getScalingFactor();
+	update(QRectF(rect.topLeft()*scale, rect.size()*scale).toAlignedRect().adjusted(-4,-4, 4,4)); // highlights are drawn around boxes
+}
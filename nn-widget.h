@@ -6,20 +6,30 @@
 #include "plugin-interface.h"
 
 #include <vector>
+#include <map>
+#include <memory>
+#include <thread>
 
 #include <QRectF>
+#include <QSizeF>
+#include <QPointF>
 class QMouseEvent;
+class QEvent;
+class QPainter;
+class ModelScene;
 
 class NnWidget : public ZoomableSvgWidget {
 	Q_OBJECT
 
 	const PluginInterface::Model* model;     // the model that is currently open in the widget
-	struct {
-		std::vector<QRectF> allOperatorBoxes;    // indexed based on OperatorId
-		std::vector<QRectF> allTensorLabelBoxes; // indexed based on TensorId
-		std::vector<QRectF> allInputBoxes;       // indexed based on input id
-		std::vector<QRectF> allOutputBoxes;      // indexed based on output id
-	} modelIndexes;
+	std::shared_ptr<const ModelScene> scene; // the drawing of the model, its grid index is used to find objects
+	int                   hoveredItem;       // scene item under the mouse, or -1
+	std::vector<unsigned> selectedItems;     // scene items selected with the rubber band
+	bool                  rubberBanding;     // Shift+drag selects boxes
+	QPointF               rubberBandStart;   // in content coordinates
+	QPointF               rubberBandEnd;
+	std::map<unsigned, std::thread> layoutThreads; // compute Graphviz layouts while linear layouts are shown, by generation
+	unsigned    layoutGeneration;            // identifies the layout that the widget currently waits for
 
 private: // types
 	struct AnyObject {
@@ -31,6 +41,7 @@ private: // types
 
 public: // constructor
 	NnWidget(QWidget *parent);
+	~NnWidget();
 
 public: // interface
 	void open(const PluginInterface::Model *model_);
@@ -38,6 +49,12 @@ public: // interface
 
 public: // overridden
 	void mousePressEvent(QMouseEvent *event) override;
+	void mouseMoveEvent(QMouseEvent *event) override;
+	void mouseReleaseEvent(QMouseEvent *event) override;
+	void leaveEvent(QEvent *event) override;
+	QSizeF getContentSize() const override;
+	TileCache::ContentPainter getContentPainter() const override;
+	void paintOverlay(QPainter &painter) const override;
 
 signals:
 	void clickedOnOperator(PluginInterface::OperatorId oid);
@@ -45,9 +62,13 @@ signals:
 	void clickedOnInput(PluginInterface::TensorId tid);
 	void clickedOnOutput(PluginInterface::TensorId tid);
 	void clickedOnBlankSpace();
+	void selectedOperators(const std::vector<PluginInterface::OperatorId> &oids); // with the rubber band
 
 private: // internals
-	void clearIndices();
+	void setScene(std::shared_ptr<const ModelScene> scene_);
+	int findItemAtThePoint(const QPointF &pt) const; // returns the scene item index or -1
 	AnyObject findObjectAtThePoint(const QPointF &pt) const;
+	void setHoveredItem(int item);
+	void updateContentRect(const QRectF &rect); // repaints the part of the widget showing rect
 };
 
@@ -0,0 +1,75 @@
+// Copyright (C) 2020 by Yuri Victorovich. All rights reserved.
+
+#pragma once
+
+#include "misc.h"
+
+#include <string>
+#include <utility>
+#include <initializer_list>
+#include <limits>
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+// Options are read from NN_INSIGHT_* environment variables, invalid values are reported and replaced with defaults
+// XXX TODO need to have a UI-based options screen for such choices
+
+namespace Options {
+
+inline const char* get(const char *name) { // nullptr when not set
+	return ::getenv(name);
+}
+
+template<typename T>
+T getChoice(const char *name, std::initializer_list<std::pair<const char*,T>> choices, T dflt) {
+	auto opt = get(name);
+	if (!opt)
+		return dflt;
+	std::string expected;
+	for (auto &c : choices) {
+		if (::strcmp(opt, c.first) == 0)
+			return c.second;
+		expected += STR((expected.empty() ? "" : ", ") << c.first);
+	}
+	WARNING("unknown value '" << opt << "' of " << name << ", expected one of: " << expected)
+	return dflt;
+}
+
+inline unsigned getUInt(const char *name, unsigned min, unsigned max, unsigned dflt) {
+	auto opt = get(name);
+	if (!opt)
+		return dflt;
+	char *end = nullptr;
+	errno = 0;
+	auto value = ::strtoull(opt, &end, 10);
+	if (end == opt || *end != 0 || errno == ERANGE || *opt == '-' || value < min || value > max) {
+		WARNING("invalid value '" << opt << "' of " << name << ", expected a number from " << min << " to " << max)
+		return dflt;
+	}
+	return value;
+}
+
+inline size_t getBytes(const char *name, size_t dflt) { // bytes with an optional K, M or G suffix
+	auto opt = get(name);
+	if (!opt)
+		return dflt;
+	char *end = nullptr;
+	errno = 0;
+	auto value = ::strtoull(opt, &end, 10);
+	bool noDigits = end == opt;
+	size_t multiplier = 1;
+	switch (*end) {
+	case 'K': multiplier = size_t(1)<<10; end++; break;
+	case 'M': multiplier = size_t(1)<<20; end++; break;
+	case 'G': multiplier = size_t(1)<<30; end++; break;
+	}
+	if (noDigits || *end != 0 || errno == ERANGE || *opt == '-' || value > std::numeric_limits<size_t>::max()/multiplier) {
+		WARNING("invalid value '" << opt << "' of " << name << ", expected bytes with an optional K, M or G suffix")
+		return dflt;
+	}
+	return value*multiplier;
+}
+
+}; // Options
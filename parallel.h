@@ -0,0 +1,38 @@
+// Copyright (C) 2020 by Yuri Victorovich. All rights reserved.
+
+#pragma once
+
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+#include <stddef.h>
+
+namespace Parallel {
+
+inline unsigned numThreads() {
+	static unsigned n = std::max(1u, std::thread::hardware_concurrency());
+	return n;
+}
+
+// splits [0,size) into chunks of at least minChunk elements and runs fn(begin,end) on them concurrently, the calling thread takes the first chunk
+template<typename Fn>
+void forRange(size_t size, size_t minChunk, Fn fn) {
+	size_t nChunks = std::min<size_t>(numThreads(), std::max<size_t>(1, size/std::max<size_t>(1, minChunk)));
+	if (nChunks <= 1) {
+		fn(size_t(0), size);
+		return;
+	}
+	size_t chunk = (size + nChunks - 1)/nChunks;
+	std::vector<std::thread> threads;
+	threads.reserve(nChunks-1);
+	for (size_t b = chunk; b < size; b += chunk)
+		threads.emplace_back([fn,b,e = std::min(b+chunk, size)]() {
+			fn(b, e);
+		});
+	fn(size_t(0), std::min(chunk, size));
+	for (auto &t : threads)
+		t.join();
+}
+
+}; // Parallel
@@ -0,0 +1,162 @@
+// Copyright (C) 2020 by Yuri Victorovich. All rights reserved.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <assert.h>
+
+// Pipeline passes items through a chain of stages that run concurrently, each stage in its own threads:
+// stages are connected by bounded queues, so a slow stage holds its producers back instead of accumulating items,
+// and every stage counts how long it was busy and how long it waited for its input and for the space in its output
+template<typename Item>
+class Pipeline {
+public: // types
+	typedef std::function<bool(Item&)> Fn; // returns false to drop the item
+	struct StageStats {
+		std::string  name;
+		unsigned     numThreads;
+		size_t       numItems;       // passed on to the next stage
+		size_t       numDropped;
+		float        busySeconds;    // summed over threads
+		float        inputWaitSeconds;
+		float        outputWaitSeconds;
+	};
+
+private: // types
+	typedef std::chrono::steady_clock Clock;
+
+	class Queue {
+		std::mutex               lock;
+		std::condition_variable  notFull;
+		std::condition_variable  notEmpty;
+		std::deque<Item>         items;
+		size_t                   capacity;
+		unsigned                 numProducers; // the queue is closed when all producers are done
+	public:
+		Queue(size_t capacity_, unsigned numProducers_) : capacity(capacity_), numProducers(numProducers_) { }
+		void push(Item &&item) {
+			std::unique_lock<std::mutex> l(lock);
+			notFull.wait(l, [this]() {return items.size() < capacity;});
+			items.push_back(std::move(item));
+			notEmpty.notify_one();
+		}
+		bool pop(Item &item) { // returns false when the queue is closed and empty
+			std::unique_lock<std::mutex> l(lock);
+			notEmpty.wait(l, [this]() {return !items.empty() || numProducers == 0;});
+			if (items.empty())
+				return false;
+			item = std::move(items.front());
+			items.pop_front();
+			notFull.notify_one();
+			return true;
+		}
+		void producerDone() {
+			std::unique_lock<std::mutex> l(lock);
+			assert(numProducers > 0);
+			if (--numProducers == 0)
+				notEmpty.notify_all();
+		}
+	};
+
+	struct Stage {
+		std::string              name;
+		unsigned                 numThreads;
+		Fn                       fn;
+		std::atomic<size_t>      numItems;
+		std::atomic<size_t>      numDropped;
+		std::atomic<uint64_t>    busyNs;
+		std::atomic<uint64_t>    inputWaitNs;
+		std::atomic<uint64_t>    outputWaitNs;
+		Stage(const std::string &name_, unsigned numThreads_, Fn fn_)
+		: name(name_), numThreads(numThreads_), fn(fn_), numItems(0), numDropped(0), busyNs(0), inputWaitNs(0), outputWaitNs(0) { }
+	};
+
+private: // fields
+	size_t                                 queueCapacity;
+	std::vector<std::unique_ptr<Stage>>    stages;
+
+public: // constructor
+	Pipeline(size_t queueCapacity_) : queueCapacity(queueCapacity_) { }
+
+public: // interface
+	void addStage(const std::string &name, unsigned numThreads, Fn fn) {
+		stages.emplace_back(new Stage(name, std::max(1u, numThreads), fn));
+	}
+
+	// runs the stages until the source returns false and all items have passed through, the source and the sink run in their own threads too
+	void run(std::function<bool(Item&)> source, std::function<void(Item&)> sink) {
+		// queues before every stage and before the sink
+		std::vector<std::unique_ptr<Queue>> queues;
+		queues.emplace_back(new Queue(queueCapacity, 1/*source*/));
+		for (auto &s : stages)
+			queues.emplace_back(new Queue(queueCapacity, s->numThreads));
+
+		auto elapsedNs = [](Clock::time_point since) {
+			return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - since).count();
+		};
+
+		std::vector<std::thread> threads;
+		threads.emplace_back([&]() { // source
+			Item item;
+			while (source(item)) {
+				queues[0]->push(std::move(item));
+				item = Item();
+			}
+			queues[0]->producerDone();
+		});
+		for (unsigned si = 0; si < stages.size(); si++)
+			for (unsigned t = 0; t < stages[si]->numThreads; t++)
+				threads.emplace_back([&,si]() {
+					auto &stage = *stages[si];
+					auto &in = *queues[si];
+					auto &out = *queues[si+1];
+					Item item;
+					while (true) {
+						auto t0 = Clock::now();
+						if (!in.pop(item))
+							break;
+						auto t1 = Clock::now();
+						stage.inputWaitNs += elapsedNs(t0);
+						bool pass = stage.fn(item);
+						auto t2 = Clock::now();
+						stage.busyNs += elapsedNs(t1);
+						if (pass) {
+							out.push(std::move(item));
+							stage.outputWaitNs += elapsedNs(t2);
+							stage.numItems++;
+						} else
+							stage.numDropped++;
+						item = Item();
+					}
+					out.producerDone();
+				});
+		threads.emplace_back([&]() { // sink
+			Item item;
+			while (queues.back()->pop(item))
+				sink(item);
+		});
+
+		for (auto &t : threads)
+			t.join();
+	}
+
+	std::vector<StageStats> getStats() const {
+		std::vector<StageStats> stats;
+		for (auto &s : stages)
+			stats.push_back(StageStats{s->name, s->numThreads, s->numItems, s->numDropped, s->busyNs/1e9f, s->inputWaitNs/1e9f, s->outputWaitNs/1e9f});
+		return stats;
+	}
+};
@@ -35,6 +35,7 @@ std::ostream& operator<<(std::ostream &os, PluginInterface::DataType dataType) {
 	case PluginInterface::DataType_Int16:     os << "in16";    break;
 	case PluginInterface::DataType_Int32:     os << "int32";   break;
 	case PluginInterface::DataType_Int64:     os << "int64";   break;
+	case PluginInterface::DataType_BFloat16:  os << "bfloat16"; break;
 	}
 	return os;
 }
@@ -78,7 +78,8 @@ public:
 		DataType_UInt8,
 		DataType_Int16,
 		DataType_Int32,
-		DataType_Int64
+		DataType_Int64,
+		DataType_BFloat16 // isn't used in model files, only in storage of computed tensors
 		// TODO? BOOL, STRING, COMPLEX64 are also supported in TfLite specification
 	};
 
@@ -10,6 +10,7 @@
 #include <string>
 #include <map>
 #include <memory>
+#include <mutex>
 
 namespace PluginManager {
 
@@ -39,7 +40,8 @@ public:
 };
 
 // plugin registry
-static std::map<std::string, std::unique_ptr<Plugin>> registry; // all loaded plugins
+static std::mutex registryLock; // plugins are loaded and unloaded from several threads, ex. by ModelRegistry
+static std::map<std::string, std::unique_ptr<Plugin>> registry; // all loaded plugins, under registryLock
 
 
 // local helpers
@@ -73,6 +75,8 @@ static std::string pluginNameToPluginLibraryPath(const std::string &pluginName)
 //
 
 const Plugin* loadPlugin(const std::string &pluginName) {
+	std::unique_lock<std::mutex> l(registryLock);
+
 	// is it already loaded?
 	{
 		auto it = registry.find(pluginName);
@@ -112,6 +116,7 @@ PluginLibInterface getInterface(const Plugin *plugin) {
 }
 
 void unloadPlugin(const Plugin *plugin) {
+	std::unique_lock<std::mutex> l(registryLock);
 	if (plugin->unref() == 0) {
 		if (::dlclose(plugin->handle) != 0)
 			PRINT_ERR("failed to unload the plugin's shared library '" << plugin->libraryPath << "': " << ::dlerror())
@@ -123,7 +123,7 @@ class TfLitePlugin : public PluginInterface {
 				return subgraph->tensors()->size();
 			}
 			TensorShape getTensorShape(TensorId tensorId) const override {
-				std::vector<unsigned> shape;
+				TensorShape shape;
 				assert(tensorId < subgraph->tensors()->size());
 				if (subgraph->tensors()->Get(tensorId)->shape() != nullptr)
 					Helpers::convertContainers(*subgraph->tensors()->Get(tensorId)->shape(), shape);
@@ -15,6 +15,7 @@
 #include "model-functions.h"
 #include "plugin-interface.h"
 #include "graphviz-cgraph.h"
+#include "layout-cache.h"
 #include "misc.h"
 #include "util.h"
 
@@ -61,6 +62,60 @@ void renderModelToCoordinates(const PluginInterface::Model *model,
 		}
 	}
 
+	// node sizes
+	auto nodeSize = [&operatorBoxMargins](QSizeF szBox) {
+		return std::array<float,2>{{
+			float(operatorBoxMargins.left() + szBox.width() + operatorBoxMargins.right()),
+			float(operatorBoxMargins.top() + szBox.height() + operatorBoxMargins.bottom())
+		}};
+	};
+	std::vector<std::array<float,2>> operatorNodeSizes;
+	for (PluginInterface::OperatorId oid = 0, oide = model->numOperators(); oid < oide; oid++)
+		operatorNodeSizes.push_back(nodeSize(operatorBoxFn(oid)));
+	std::map<PluginInterface::TensorId, std::array<float,2>> inputNodeSizes, outputNodeSizes;
+	for (auto i : model->getInputs())
+		inputNodeSizes[i] = nodeSize(inputBoxFn(i));
+	for (auto o : model->getOutputs())
+		outputNodeSizes[o] = nodeSize(outputBoxFn(o));
+
+	/// look for the cached layout
+
+	// the key describes everything that the layout depends on
+	std::string layoutKey;
+	{
+		std::ostringstream ss;
+		ss << "dpi=" << Util::getScreenDPI() << "\n";
+		for (auto &sz : operatorNodeSizes)
+			ss << "op " << sz[0] << "x" << sz[1] << "\n";
+		for (PluginInterface::TensorId tid = 0, tide = model->numTensors(); tid < tide; tid++)
+			if (tensorProducers[tid] != -1 && !tensorConsumers[tid].empty())
+				for (auto oidConsumer : tensorConsumers[tid])
+					ss << "edge " << tensorProducers[tid] << "->" << oidConsumer << " " << model->getTensorShape(tid) << "\n";
+		for (auto &i : inputNodeSizes) {
+			ss << "input " << i.first << " " << i.second[0] << "x" << i.second[1] << "\n";
+			for (auto oidConsumer : tensorConsumers[i.first])
+				ss << "edge src->" << oidConsumer << " " << model->getTensorShape(i.first) << "\n";
+		}
+		for (auto &o : outputNodeSizes)
+			ss << "output " << o.first << " " << o.second[0] << "x" << o.second[1] << " " << tensorProducers[o.first] << " " << model->getTensorShape(o.first) << "\n";
+		layoutKey = ss.str();
+	}
+
+	{
+		LayoutCache::Layout layout;
+		if (LayoutCache::load(layoutKey, layout)
+			&& layout.operatorBoxes.size() == model->numOperators() && layout.tensorLineCubicSplines.size() == model->numTensors())
+		{
+			bbox = layout.bbox;
+			operatorBoxes = std::move(layout.operatorBoxes);
+			inputBoxes = std::move(layout.inputBoxes);
+			outputBoxes = std::move(layout.outputBoxes);
+			tensorLineCubicSplines = std::move(layout.tensorLineCubicSplines);
+			tensorLabelPositions = std::move(layout.tensorLabelPositions);
+			return;
+		}
+	}
+
 	/// build the graphviz graph
 
 	// create the graph
@@ -75,11 +130,7 @@ void renderModelToCoordinates(const PluginInterface::Model *model,
 	std::vector<Graphviz_CGraph::Node> operatorNodes;
 	for (PluginInterface::OperatorId oid = 0, oide = model->numOperators(); oid < oide; oid++) {
 		auto node = graph.addNode(CSTR("Op_" << oid));
-		auto szBox = operatorBoxFn(oid);
-		graph.setNodeSize(node,
-			operatorBoxMargins.left() + szBox.width() + operatorBoxMargins.right(),
-			operatorBoxMargins.top() + szBox.height() + operatorBoxMargins.bottom()
-		);
+		graph.setNodeSize(node, operatorNodeSizes[oid][0], operatorNodeSizes[oid][1]);
 		operatorNodes.push_back(node);
 	}
 
@@ -98,11 +149,7 @@ void renderModelToCoordinates(const PluginInterface::Model *model,
 	std::map<PluginInterface::TensorId, Graphviz_CGraph::Node> inputNodes;
 	for (auto i : model->getInputs()) {
 		auto node = graph.addNode(CSTR("Src_" << i));
-		auto szBox = inputBoxFn(i);
-		graph.setNodeSize(node,
-			operatorBoxMargins.left() + szBox.width() + operatorBoxMargins.right(),
-			operatorBoxMargins.top() + szBox.height() + operatorBoxMargins.bottom()
-		);
+		graph.setNodeSize(node, inputNodeSizes[i][0], inputNodeSizes[i][1]);
 		inputNodes[i] = node;
 		// edges
 		for (auto oidConsumer : tensorConsumers[i]) {
@@ -116,11 +163,7 @@ void renderModelToCoordinates(const PluginInterface::Model *model,
 	std::map<PluginInterface::TensorId, Graphviz_CGraph::Node> outputNodes;
 	for (auto o : model->getOutputs()) {
 		auto node = graph.addNode(CSTR("Dst_" << o));
-		auto szBox = outputBoxFn(o);
-		graph.setNodeSize(node,
-			operatorBoxMargins.left() + szBox.width() + operatorBoxMargins.right(),
-			operatorBoxMargins.top() + szBox.height() + operatorBoxMargins.bottom()
-		);
+		graph.setNodeSize(node, outputNodeSizes[o][0], outputNodeSizes[o][1]);
 		outputNodes[o] = node;
 		// edge
 		auto edge = graph.addEdge(operatorNodes[tensorProducers[o]], node, ""/*name(key)*/);
@@ -155,6 +198,115 @@ void renderModelToCoordinates(const PluginInterface::Model *model,
 			// label position
 			tensorLabelPositions[tid].push_back(graph.getEdgeLabelPosition(edge));
 		}
+
+	/// save the layout for the next time
+
+	LayoutCache::save(layoutKey, {bbox, operatorBoxes, inputBoxes, outputBoxes, tensorLineCubicSplines, tensorLabelPositions});
+}
+
+void renderModelToCoordinatesLinear(const PluginInterface::Model *model,
+	const QMarginsF &operatorBoxMargins,
+	std::function<QSizeF(PluginInterface::OperatorId)> operatorBoxFn,
+	std::function<QSizeF(PluginInterface::TensorId)> inputBoxFn,
+	std::function<QSizeF(PluginInterface::TensorId)> outputBoxFn,
+	Box2 &bbox,
+	std::vector<Box2> &operatorBoxes,
+	std::map<PluginInterface::TensorId, Box2> &inputBoxes,
+	std::map<PluginInterface::TensorId, Box2> &outputBoxes,
+	std::vector<std::vector<std::vector<std::array<float,2>>>> &tensorLineCubicSplines,
+	std::vector<std::vector<std::array<float,2>>> &tensorLabelPositions
+) {
+	const float gap = 0.35;          // between rows, in inches
+	const float labelOffset = 0.6;   // labels of straight edges are to the right of them
+	const float detourStep = 0.05;   // edges skipping rows go around on the right, longer edges further away
+
+	// rows: inputs, operators, outputs
+	auto boxSize = [&operatorBoxMargins](QSizeF szBox) {
+		return std::array<float,2>{{
+			float(operatorBoxMargins.left() + szBox.width() + operatorBoxMargins.right()),
+			float(operatorBoxMargins.top() + szBox.height() + operatorBoxMargins.bottom())
+		}};
+	};
+	std::vector<std::array<float,2>> rowSizes;
+	std::map<PluginInterface::TensorId, unsigned> inputRows, outputRows;
+	for (auto i : model->getInputs()) {
+		inputRows[i] = rowSizes.size();
+		rowSizes.push_back(boxSize(inputBoxFn(i)));
+	}
+	unsigned operatorRow0 = rowSizes.size();
+	for (PluginInterface::OperatorId oid = 0, oide = model->numOperators(); oid < oide; oid++)
+		rowSizes.push_back(boxSize(operatorBoxFn(oid)));
+	for (auto o : model->getOutputs()) {
+		outputRows[o] = rowSizes.size();
+		rowSizes.push_back(boxSize(outputBoxFn(o)));
+	}
+
+	// row centers, Y goes up like in Graphviz
+	float maxWidth = 0, height = 0;
+	for (auto &sz : rowSizes) {
+		maxWidth = std::max(maxWidth, sz[0]);
+		height += sz[1] + gap;
+	}
+	height -= gap;
+	float x0 = maxWidth/2, xMax = maxWidth;
+	std::vector<Box2> rowBoxes;
+	for (float y = height; auto &sz : rowSizes) {
+		rowBoxes.push_back(Box2{{{x0, y - sz[1]/2}, sz}});
+		y -= sz[1] + gap;
+	}
+
+	// boxes
+	for (PluginInterface::OperatorId oid = 0, oide = model->numOperators(); oid < oide; oid++)
+		operatorBoxes.push_back(rowBoxes[operatorRow0 + oid]);
+	for (auto &it : inputRows)
+		inputBoxes[it.first] = rowBoxes[it.second];
+	for (auto &it : outputRows)
+		outputBoxes[it.first] = rowBoxes[it.second];
+
+	// edges
+	tensorLineCubicSplines.resize(model->numTensors());
+	tensorLabelPositions.resize(model->numTensors());
+	auto addEdge = [&](PluginInterface::TensorId tid, unsigned rowFrom, unsigned rowTo) {
+		auto &bf = rowBoxes[rowFrom], &bt = rowBoxes[rowTo];
+		std::array<float,2> p0, c0, c1, p1, lp;
+		if (rowTo == rowFrom+1) { // straight down
+			p0 = {x0, bf[0][1] - bf[1][1]/2};
+			p1 = {x0, bt[0][1] + bt[1][1]/2};
+			c0 = {x0, (2*p0[1] + p1[1])/3};
+			c1 = {x0, (p0[1] + 2*p1[1])/3};
+			lp = {x0 + labelOffset, (p0[1] + p1[1])/2};
+		} else { // around the boxes in between
+			float xDetour = x0 + maxWidth/2 + gap + detourStep*std::min(rowTo > rowFrom ? rowTo-rowFrom : rowFrom-rowTo, 20u);
+			p0 = {x0 + bf[1][0]/2, bf[0][1]};
+			p1 = {x0 + bt[1][0]/2, bt[0][1]};
+			c0 = {xDetour, p0[1]};
+			c1 = {xDetour, p1[1]};
+			lp = {xDetour, (p0[1] + p1[1])/2};
+		}
+		xMax = std::max(xMax, lp[0] + labelOffset);
+		tensorLineCubicSplines[tid].push_back({{-1,-1}/*startp*/, {-1,-1}/*endp*/, p0, c0, c1, p1});
+		tensorLabelPositions[tid].push_back(lp);
+	};
+	std::vector<int/*row or -1*/> tensorProducerRows(model->numTensors(), -1);
+	std::vector<std::set<unsigned>> tensorConsumerRows(model->numTensors());
+	for (PluginInterface::OperatorId oid = 0, oide = model->numOperators(); oid < oide; oid++) {
+		std::vector<PluginInterface::TensorId> oinputs, ooutputs;
+		model->getOperatorIo(oid, oinputs, ooutputs);
+		for (auto o : ooutputs)
+			tensorProducerRows[o] = operatorRow0 + oid;
+		for (auto i : oinputs)
+			tensorConsumerRows[i].insert(operatorRow0 + oid);
+	}
+	for (auto &it : inputRows)
+		tensorProducerRows[it.first] = it.second;
+	for (auto &it : outputRows)
+		tensorConsumerRows[it.first].insert(it.second);
+	for (PluginInterface::TensorId tid = 0, tide = model->numTensors(); tid < tide; tid++)
+		if (tensorProducerRows[tid] != -1)
+			for (auto row : tensorConsumerRows[tid])
+				addEdge(tid, tensorProducerRows[tid], row);
+
+	bbox = Box2{{{0,0}, {xMax, height}}};
 }
 
 }
@@ -0,0 +1,199 @@
+// Copyright (C) 2020 by Yuri Victorovich. All rights reserved.
+
+#pragma once
+
+#include "tensor.h"
+
+#include <atomic>
+#include <algorithm>
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+// wire format between nn-insight-serve and its clients: every message is a fixed-size header followed by the payload,
+// both sides are on the same machine so integers and floats are in the native byte order
+namespace ServeProtocol {
+
+enum {Magic = 0x4e4e4953}; // "NNIS"
+
+enum RequestKind : uint32_t {
+	RequestKind_Info,       // no payload, the response describes the model input, its payload is the Shape of the model output
+	RequestKind_Infer,      // payload is the float32 model input
+	RequestKind_AttachRing  // no payload, followed by sendFds() with the ring memfd and two eventfds: "submitted" and "completed",
+	                        // after the response the connection only serves the ring until it is closed
+};
+
+enum Status : uint32_t {
+	Status_Ok,
+	Status_Error          // payload is the error message
+};
+
+struct Shape {
+	uint32_t rank;
+	uint32_t dims[TensorShape::MaxRank];
+
+	static Shape fromTensorShape(const TensorShape &shape) {
+		Shape s = {};
+		s.rank = shape.size();
+		for (unsigned i = 0; i < shape.size(); i++)
+			s.dims[i] = shape[i];
+		return s;
+	}
+	TensorShape toTensorShape() const {
+		return TensorShape(dims, dims + (rank <= TensorShape::MaxRank ? rank : 0));
+	}
+};
+
+struct RequestHeader {
+	uint32_t    magic;
+	RequestKind kind;
+	uint32_t    model;       // index of the model in the server's list
+	Shape       shape;
+	uint64_t    payloadSize; // bytes
+};
+
+struct ResponseHeader {
+	uint32_t    magic;
+	Status      status;
+	Shape       shape;       // Info: shape of the model input, Infer: shape of the model output
+	uint64_t    payloadSize; // bytes
+};
+
+// shared memory ring: the client writes inputs directly into the slots that the server uses as the model input tensors,
+// the server writes outputs into the same slots, no data passes through the socket
+enum {RingAlignment = 64}; // TensorAllocator::Alignment
+
+enum SlotState : uint32_t {
+	SlotState_Free,       // owned by the client
+	SlotState_Submitted,  // the input is ready, the client signals the "submitted" eventfd
+	SlotState_Busy,       // owned by the server, the input must not change
+	SlotState_Done        // the output is ready, the server signals the "completed" eventfd
+};
+
+struct RingHeader {
+	uint32_t    magic;
+	uint32_t    numSlots;
+	uint64_t    slotSize;       // bytes, slots follow the header at ringHeaderSize()
+	uint64_t    inputOffset;    // bytes from the slot beginning
+	uint64_t    outputOffset;
+	uint64_t    outputCapacity; // bytes
+};
+
+struct RingSlot {
+	std::atomic<uint32_t> state;  // SlotState
+	Status      status;
+	Shape       outputShape;
+	uint64_t    outputSize;       // bytes, the error message when status is Status_Error
+};
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "slot states are shared between processes");
+
+constexpr size_t alignRing(size_t sz) {return (sz + RingAlignment-1) & ~size_t(RingAlignment-1);}
+constexpr size_t ringHeaderSize() {return alignRing(sizeof(RingHeader));}
+
+inline size_t ringLayout(unsigned numSlots, size_t inputSize, size_t outputSize, RingHeader &hdr) { // returns the total size
+	hdr.magic = Magic;
+	hdr.numSlots = numSlots;
+	hdr.inputOffset = alignRing(sizeof(RingSlot));
+	hdr.outputOffset = hdr.inputOffset + alignRing(inputSize);
+	hdr.outputCapacity = alignRing(outputSize);
+	hdr.slotSize = hdr.outputOffset + hdr.outputCapacity;
+	return ringHeaderSize() + numSlots*hdr.slotSize;
+}
+
+inline uint8_t* ringSlot(void *ring, const RingHeader &hdr, unsigned slot) {
+	return static_cast<uint8_t*>(ring) + ringHeaderSize() + slot*hdr.slotSize;
+}
+
+// blocking i/o helpers: sockets can return partial reads and writes
+inline bool readFully(int fd, void *buf, size_t size) {
+	for (auto p = static_cast<uint8_t*>(buf); size > 0;) {
+		auto n = ::read(fd, p, size);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false; // error or EOF
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+
+inline bool writeFully(int fd, const void *buf, size_t size) {
+	for (auto p = static_cast<const uint8_t*>(buf); size > 0;) {
+		auto n = ::write(fd, p, size);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+
+// file descriptors are passed as SCM_RIGHTS along with one byte of data
+enum {MaxFds = 4};
+
+inline bool sendFds(int sock, const int *fds, unsigned numFds) {
+	char byte = 0;
+	struct iovec iov = {&byte, 1};
+	alignas(struct cmsghdr) char control[CMSG_SPACE(MaxFds*sizeof(int))] = {};
+	struct msghdr msg = {};
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = CMSG_SPACE(numFds*sizeof(int));
+	auto cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(numFds*sizeof(int));
+	::memcpy(CMSG_DATA(cmsg), fds, numFds*sizeof(int));
+	while (true) {
+		auto n = ::sendmsg(sock, &msg, 0);
+		if (n == -1 && errno == EINTR)
+			continue;
+		return n == 1;
+	}
+}
+
+inline bool receiveFds(int sock, int *fds, unsigned numFds) { // fails unless exactly numFds descriptors are received
+	char byte;
+	struct iovec iov = {&byte, 1};
+	alignas(struct cmsghdr) char control[CMSG_SPACE(MaxFds*sizeof(int))] = {};
+	struct msghdr msg = {};
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+	ssize_t n;
+	while ((n = ::recvmsg(sock, &msg, MSG_CMSG_CLOEXEC)) == -1 && errno == EINTR)
+		;
+	if (n != 1)
+		return false;
+	unsigned received = 0;
+	for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+		if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+			auto num = (cmsg->cmsg_len - CMSG_LEN(0))/sizeof(int);
+			for (unsigned i = 0; i < num; i++) {
+				int fd;
+				::memcpy(&fd, CMSG_DATA(cmsg) + i*sizeof(int), sizeof(int));
+				if (received < numFds)
+					fds[received] = fd;
+				else
+					::close(fd);
+				received++;
+			}
+		}
+	if (received != numFds) {
+		for (unsigned i = 0; i < std::min(received, numFds); i++)
+			::close(fds[i]);
+		return false;
+	}
+	return true;
+}
+
+}
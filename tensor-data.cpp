@@ -0,0 +1,194 @@
+// Copyright (C) 2020 by Yuri Victorovich. All rights reserved.
+
+#include "tensor-data.h"
+#include "misc.h"
+
+#include <new>
+#include <functional>
+#include <cstring>
+
+#include <assert.h>
+
+typedef PluginInterface PI;
+
+/// TensorAllocator
+
+class HeapTensorAllocator : public TensorAllocator {
+public:
+	void* allocate(size_t bytes) override {
+		return ::operator new(bytes, std::align_val_t(Alignment));
+	}
+	void deallocate(void *ptr, size_t bytes) override {
+		::operator delete(ptr, std::align_val_t(Alignment));
+	}
+};
+
+TensorAllocator* TensorAllocator::heap() {
+	static auto allocator = std::make_shared<HeapTensorAllocator>();
+	return allocator.get();
+}
+
+/// constructors
+
+TensorData::TensorData()
+: dataType(PI::DataType_Float32)
+, offset(0)
+{
+}
+
+TensorData TensorData::allocate(PI::DataType dataType, const TensorShape &shape, TensorAllocator *allocator) {
+	if (!allocator)
+		allocator = TensorAllocator::heap();
+
+	TensorData t;
+	t.dataType = dataType;
+	t.shape = shape;
+	t.strides = denseStrides(shape);
+	auto bytes = t.sizeInBytes();
+	t.storage.reset(allocator->allocate(bytes), [allocator = allocator->shared_from_this(),bytes](void *ptr) {
+		allocator->deallocate(ptr, bytes);
+	});
+	return t;
+}
+
+TensorData TensorData::adopt(PI::DataType dataType, const TensorShape &shape, std::shared_ptr<const void> storage) {
+	TensorData t;
+	t.dataType = dataType;
+	t.shape = shape;
+	t.strides = denseStrides(shape);
+	t.storage = std::const_pointer_cast<void>(storage);
+	return t;
+}
+
+TensorData TensorData::external(PI::DataType dataType, const TensorShape &shape, const void *data) {
+	return adopt(dataType, shape, std::shared_ptr<const void>(data, [](const void*) { }));
+}
+
+/// properties
+
+bool TensorData::isContiguous() const {
+	auto dense = denseStrides(shape);
+	for (unsigned i = 0; i < shape.size(); i++)
+		if (shape[i] > 1 && strides[i] != dense[i])
+			return false;
+	return true;
+}
+
+/// data access
+
+void TensorData::reset() {
+	storage.reset();
+	shape = TensorShape();
+	strides = TensorShape();
+	offset = 0;
+}
+
+/// views
+
+TensorData TensorData::reshaped(const TensorShape &newShape) const {
+	assert(isContiguous()); // strided views can't be reshaped without copying
+	assert(Tensor::flatSize(newShape) == numElements());
+	TensorData t = *this;
+	t.shape = newShape;
+	t.strides = denseStrides(newShape);
+	return t;
+}
+
+TensorData TensorData::squeezed() const {
+	TensorData t = *this;
+	t.shape = TensorShape();
+	t.strides = TensorShape();
+	for (unsigned i = 0; i < shape.size(); i++)
+		if (shape[i] != 1) {
+			t.shape.push_back(shape[i]);
+			t.strides.push_back(strides[i]);
+		}
+	return t;
+}
+
+TensorData TensorData::sliced(unsigned dim, unsigned begin, unsigned end, unsigned step) const {
+	assert(dim < shape.size() && begin <= end && end <= shape[dim] && step > 0);
+	TensorData t = *this;
+	t.offset += begin*strides[dim];
+	t.shape[dim] = (end-begin+step-1)/step;
+	t.strides[dim] = strides[dim]*step;
+	return t;
+}
+
+/// conversions
+
+TensorData TensorData::contiguous(TensorAllocator *allocator) const {
+	if (isContiguous())
+		return *this;
+
+	auto t = allocate(dataType, shape, allocator);
+	auto elementSize = dataTypeSize(dataType);
+	auto src = static_cast<const uint8_t*>(storage.get()) + offset*elementSize;
+	auto dst = t.mutableData<uint8_t>();
+	std::function<void(unsigned,const uint8_t*)> copyDim = [&](unsigned dim, const uint8_t *src) {
+		if (dim+1 == shape.size()) {
+			if (strides[dim] == 1) { // the innermost dimension is dense: copy it at once
+				memcpy(dst, src, shape[dim]*elementSize);
+				dst += shape[dim]*elementSize;
+			} else
+				for (unsigned i = 0; i < shape[dim]; i++, src += strides[dim]*elementSize, dst += elementSize)
+					memcpy(dst, src, elementSize);
+		} else
+			for (unsigned i = 0; i < shape[dim]; i++, src += strides[dim]*elementSize)
+				copyDim(dim+1, src);
+	};
+	copyDim(0, src);
+	return t;
+}
+
+TensorData TensorData::compacted(ActivationStorage activationStorage, TensorAllocator *allocator) const {
+	assert(dataType == PI::DataType_Float32 && isContiguous());
+	assert(activationStorage != ActivationStorage_Float32);
+	auto t = allocate(activationStorage == ActivationStorage_Float16 ? PI::DataType_Float16 : PI::DataType_BFloat16, shape, allocator);
+	Tensor::compactFloat32(get(), t.mutableData<uint16_t>(), numElements(), activationStorage);
+	return t;
+}
+
+TensorData TensorData::toFloat32() const {
+	switch (dataType) {
+	case PI::DataType_Float32:
+		return *this;
+	case PI::DataType_Float16:
+	case PI::DataType_BFloat16: {
+		auto src = contiguous();
+		auto t = allocate(PI::DataType_Float32, shape);
+		Tensor::expandToFloat32(src.data<uint16_t>(), t.mutableData<float>(), numElements(),
+			dataType == PI::DataType_Float16 ? ActivationStorage_Float16 : ActivationStorage_BFloat16);
+		return t;
+	} default:
+		FAIL("conversion from " << dataType << " to float32 isn't supported")
+	}
+}
+
+/// helpers
+
+size_t TensorData::dataTypeSize(PI::DataType dataType) {
+	switch (dataType) {
+	case PI::DataType_Float16:  return 2;
+	case PI::DataType_BFloat16: return 2;
+	case PI::DataType_Float32:  return 4;
+	case PI::DataType_Float64:  return 8;
+	case PI::DataType_Int8:     return 1;
+	case PI::DataType_UInt8:    return 1;
+	case PI::DataType_Int16:    return 2;
+	case PI::DataType_Int32:    return 4;
+	case PI::DataType_Int64:    return 8;
+	}
+	FAIL("unknown data type " << dataType)
+}
+
+TensorShape TensorData::denseStrides(const TensorShape &shape) {
+	TensorShape strides = shape;
+	unsigned stride = 1;
+	for (auto it = strides.rbegin(); it != strides.rend(); it++) {
+		auto dim = *it;
+		*it = stride;
+		stride *= dim;
+	}
+	return strides;
+}
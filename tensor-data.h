@@ -0,0 +1,89 @@
+// Copyright (C) 2020 by Yuri Victorovich. All rights reserved.
+
+#pragma once
+
+#include "plugin-interface.h"
+#include "tensor.h"
+#include "nn-types.h"
+
+#include <memory>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <assert.h>
+
+// TensorAllocator provides storage for tensors, all allocations are aligned to TensorAllocator::Alignment bytes
+// allocators have to be owned by std::shared_ptr: tensors keep their allocator alive until their storage is returned to it
+class TensorAllocator : public std::enable_shared_from_this<TensorAllocator> {
+public:
+	enum {Alignment = 64}; // cache line size and the widest SIMD register
+
+	virtual ~TensorAllocator() { }
+	virtual void* allocate(size_t bytes) = 0;
+	virtual void deallocate(void *ptr, size_t bytes) = 0;
+
+	static TensorAllocator* heap(); // the default allocator
+};
+
+// TensorData is the typed tensor: it describes its data type, shape and strides and refers to the storage that it shares with its views
+class TensorData {
+	typedef PluginInterface PI;
+
+	PI::DataType                dataType;
+	TensorShape                 shape;
+	TensorShape                 strides; // in elements
+	size_t                      offset;  // in elements from the beginning of the storage
+	std::shared_ptr<void>       storage;
+
+public: // constructors
+	TensorData();
+	static TensorData allocate(PI::DataType dataType, const TensorShape &shape, TensorAllocator *allocator = nullptr); // uninitialized
+	static TensorData adopt(PI::DataType dataType, const TensorShape &shape, std::shared_ptr<const void> storage); // takes shared ownership of the existing dense data
+	static TensorData external(PI::DataType dataType, const TensorShape &shape, const void *data); // refers to dense data that outlives the tensor, ex. static data in the model
+
+public: // properties
+	explicit operator bool() const {return (bool)storage;}
+	PI::DataType getDataType() const {return dataType;}
+	const TensorShape& getShape() const {return shape;}
+	const TensorShape& getStrides() const {return strides;}
+	size_t numElements() const {return Tensor::flatSize(shape);}
+	size_t sizeInBytes() const {return numElements()*dataTypeSize(dataType);}
+	bool isContiguous() const;
+	long useCount() const {return storage.use_count();} // how many tensors share this storage
+	const void* storageId() const {return storage.get();} // the same for all tensors sharing the storage
+
+public: // data access
+	template<typename T>
+	const T* data() const {
+		assert(storage);
+		return static_cast<const T*>(storage.get()) + offset;
+	}
+	template<typename T>
+	T* mutableData() { // only for filling the newly allocated tensor
+		assert(storage);
+		return static_cast<T*>(storage.get()) + offset;
+	}
+	const void* rawData() const {
+		assert(storage);
+		return static_cast<const uint8_t*>(storage.get()) + offset*dataTypeSize(dataType);
+	}
+	const float* get() const { // dense float32 data as computation kernels use it
+		assert(!storage || (dataType == PI::DataType_Float32 && isContiguous()));
+		return storage ? data<float>() : nullptr;
+	}
+	void reset();
+
+public: // views: they share the storage, no data is copied
+	TensorData reshaped(const TensorShape &newShape) const;
+	TensorData squeezed() const; // without dimensions equal to 1
+	TensorData sliced(unsigned dim, unsigned begin, unsigned end, unsigned step = 1) const;
+
+public: // conversions: they allocate new storage
+	TensorData contiguous(TensorAllocator *allocator = nullptr) const; // returns itself when it is already contiguous
+	TensorData compacted(ActivationStorage activationStorage, TensorAllocator *allocator = nullptr) const; // float32 -> float16/bfloat16
+	TensorData toFloat32() const; // float16/bfloat16 -> float32, returns itself when it is already float32
+
+public: // helpers
+	static size_t dataTypeSize(PI::DataType dataType);
+	static TensorShape denseStrides(const TensorShape &shape);
+};
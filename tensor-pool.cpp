@@ -0,0 +1,73 @@
+// Copyright (C) 2020 by Yuri Victorovich. All rights reserved.
+
+#include "tensor-pool.h"
+
+#include <assert.h>
+
+TensorPool::TensorPool()
+: stats({0,0,0,0})
+{
+}
+
+TensorPool::~TensorPool() {
+	assert(stats.bytesInUse == 0); // tensors keep their allocator alive, see TensorData::allocate
+	trim();
+}
+
+/// TensorAllocator interface
+
+void* TensorPool::allocate(size_t bytes) {
+	auto sz = sizeClass(bytes);
+	{
+		std::unique_lock<std::mutex> l(lock);
+		stats.bytesInUse += sz;
+		auto it = freeLists.find(sz);
+		if (it != freeLists.end() && !it->second.empty()) {
+			auto ptr = it->second.back();
+			it->second.pop_back();
+			stats.hits++;
+			stats.bytesPooled -= sz;
+			return ptr;
+		}
+		stats.misses++;
+	}
+	return heap()->allocate(sz);
+}
+
+void TensorPool::deallocate(void *ptr, size_t bytes) {
+	auto sz = sizeClass(bytes);
+	std::unique_lock<std::mutex> l(lock);
+	freeLists[sz].push_back(ptr);
+	stats.bytesInUse -= sz;
+	stats.bytesPooled += sz;
+}
+
+/// own interface
+
+TensorPool::Stats TensorPool::getStats() const {
+	std::unique_lock<std::mutex> l(lock);
+	return stats;
+}
+
+size_t TensorPool::trim() {
+	std::map<size_t, std::vector<void*>> released;
+	{
+		std::unique_lock<std::mutex> l(lock);
+		released.swap(freeLists);
+		stats.bytesPooled = 0;
+	}
+	size_t bytes = 0;
+	for (auto &sizeClassBuffers : released)
+		for (auto ptr : sizeClassBuffers.second) {
+			heap()->deallocate(ptr, sizeClassBuffers.first);
+			bytes += sizeClassBuffers.first;
+		}
+	return bytes;
+}
+
+size_t TensorPool::sizeClass(size_t bytes) {
+	if (bytes <= 256)
+		return bytes <= Alignment ? Alignment : (bytes+Alignment-1)/Alignment*Alignment;
+	size_t step = size_t(1) << (63 - __builtin_clzll((unsigned long long)bytes-1) - 2); // a quarter of the power of 2 below
+	return (bytes+step-1)/step*step;
+}
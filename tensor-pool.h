@@ -0,0 +1,41 @@
+// Copyright (C) 2020 by Yuri Victorovich. All rights reserved.
+
+#pragma once
+
+#include "tensor-data.h"
+
+#include <map>
+#include <vector>
+#include <mutex>
+
+#include <stddef.h>
+
+// TensorPool recycles tensor buffers: freed buffers are kept in free lists by size class and are handed out again,
+// so that repeated computations of the same model allocate nothing after the first one
+class TensorPool : public TensorAllocator {
+public:
+	struct Stats {
+		size_t hits;        // allocations served from free lists
+		size_t misses;      // allocations that went to the heap
+		size_t bytesInUse;  // in size-class bytes
+		size_t bytesPooled; // kept in free lists
+	};
+
+private:
+	mutable std::mutex                       lock;
+	std::map<size_t, std::vector<void*>>     freeLists; // size class -> free buffers
+	Stats                                    stats;
+
+public: // constructor: has to be owned by std::shared_ptr, see TensorAllocator
+	TensorPool();
+	~TensorPool();
+
+public: // TensorAllocator interface
+	void* allocate(size_t bytes) override;
+	void deallocate(void *ptr, size_t bytes) override;
+
+public: // own interface
+	Stats getStats() const;
+	size_t trim(); // returns all pooled buffers to the heap, returns the number of bytes released
+	static size_t sizeClass(size_t bytes); // rounds bytes up to one of 4 sizes per power of 2, so at most 25% is wasted
+};
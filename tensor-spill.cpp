@@ -0,0 +1,60 @@
+// Copyright (C) 2020 by Yuri Victorovich. All rights reserved.
+
+#include "tensor-spill.h"
+#include "misc.h"
+
+#include <string>
+#include <cstring>
+
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+namespace TensorSpill {
+
+TensorData spill(const TensorData &tensor) {
+	auto src = tensor.contiguous();
+	size_t bytes = src.sizeInBytes();
+	if (bytes == 0)
+		return src; // nothing to spill
+
+	// create the scratch file
+	auto tmpdir = ::getenv("TMPDIR");
+	std::string fileName = STR((tmpdir && *tmpdir ? tmpdir : "/tmp") << "/nn-insight-tensor.XXXXXX");
+	int fd = ::mkstemp(&fileName[0]);
+	if (fd == -1) {
+		WARNING("failed to create the scratch file '" << fileName << "': " << strerror(errno))
+		return TensorData();
+	}
+	::unlink(fileName.c_str()); // the file is only reachable through the mapping, it goes away when the tensor is released
+	if (int err = ::posix_fallocate(fd, 0, bytes)) { // allocate the blocks now: writing into a sparse file on a full disk would raise SIGBUS
+		WARNING("failed to allocate " << bytes << " bytes for the scratch file '" << fileName << "': " << strerror(err))
+		::close(fd);
+		return TensorData();
+	}
+
+	// mmap it
+	void *m = ::mmap(0/*addr*/, bytes, PROT_READ|PROT_WRITE, MAP_SHARED/*flags*/, fd, 0/*offset*/);
+	if (m == MAP_FAILED) {
+		WARNING("failed to mmap the scratch file '" << fileName << "': " << strerror(errno))
+		::close(fd);
+		return TensorData();
+	}
+	if (::close(fd) == -1) // the mapping keeps the file
+		WARNING("failed to close the scratch file '" << fileName << "': " << strerror(errno))
+
+	// copy the data and start writing it out, clean pages can be dropped under memory pressure
+	memcpy(m, src.rawData(), bytes);
+	if (::msync(m, bytes, MS_ASYNC) == -1)
+		WARNING("failed to msync the scratch file '" << fileName << "': " << strerror(errno))
+
+	return TensorData::adopt(src.getDataType(), src.getShape(), std::shared_ptr<const void>(m, [bytes](const void *p) {
+		if (::munmap(const_cast<void*>(p), bytes) == -1)
+			WARNING("failed to unmmap the scratch file: " << strerror(errno))
+	}));
+}
+
+}
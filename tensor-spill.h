@@ -0,0 +1,14 @@
+// Copyright (C) 2020 by Yuri Victorovich. All rights reserved.
+
+#pragma once
+
+#include "tensor-data.h"
+
+namespace TensorSpill {
+
+// copies the tensor into an unlinked scratch file in $TMPDIR and returns the tensor backed by its mapping:
+// the kernel can then write its pages out to the file and read them back on access instead of swapping the process
+// returns an empty tensor when the scratch file can't be created
+TensorData spill(const TensorData &tensor);
+
+}
@@ -11,49 +11,20 @@
 #include <string>
 
 #include <assert.h>
+#include <string.h>
+#include <half.hpp>
 #include <nlohmann/json.hpp>
 
 namespace Tensor {
 
-size_t flatSize(const TensorShape &shape) {
-	size_t sz = 1;
-	for (auto d : shape)
-		sz *= d;
-	return sz;
-}
-
-unsigned numMultiDims(const TensorShape &shape) {
-	unsigned numMultiDims = 0;
-	for (auto d : shape)
-		if (d > 1)
-			numMultiDims++;
-	return numMultiDims;
-}
-
-TensorShape getLastDims(const TensorShape &shape, unsigned ndims) {
-	TensorShape s = shape;
-	while (s.size() > ndims)
-		s.erase(s.begin());
-	return s;
-}
-
-TensorShape stripLeadingOnes(const TensorShape &shape) {
-	TensorShape s = shape;
-	while (!s.empty() && s[0]==1)
-		s.erase(s.begin());
-	return s;
-}
-
 bool isSubset(const TensorShape &shapeLarge, const TensorShape &shapeSmall) {
 	// check size
 	if (shapeLarge.size() < shapeSmall.size())
 		return false;
 
 	// strip ones
-	TensorShape small = shapeSmall;
-	while (!small.empty() && small[0]==1)
-		small.erase(small.begin());
-	
+	TensorShape small = stripLeadingOnes(shapeSmall);
+
 	// compare
 	for (TensorShape::const_reverse_iterator it = small.rbegin(), ite = small.rend(), itl = shapeLarge.rbegin(); it!=ite; it++, itl++)
 		if (*it != *itl)
@@ -69,7 +40,7 @@ float* computeArgMax(const TensorShape &inputShape, const float *input, const st
 
 	auto inputSize = flatSize(inputShape);
 	auto nchannels = *inputShape.rbegin();
-	std::unique_ptr<float> output(new float[inputSize/nchannels*3]);
+	std::unique_ptr<float[]> output(new float[inputSize/nchannels*3]);
 	float *o = output.get();
 
 	for (auto inpute = input+inputSize; input<inpute; ) {
@@ -140,7 +111,7 @@ bool readTensorDataAsJson(const char *fileName, const TensorShape &shape, std::s
 	                 std::istreambuf_iterator<char>());
 
 	auto shapeSize = flatSize(shape);
-	std::unique_ptr<float> data(new float[shapeSize]);
+	std::unique_ptr<float[]> data(new float[shapeSize]);
 	float *p = data.get(), *pe = p + shapeSize;
 
 	std::function<bool(const json &j)> one;
@@ -160,7 +131,7 @@ bool readTensorDataAsJson(const char *fileName, const TensorShape &shape, std::s
 	};
 
 	if (one(json::parse(str)) && p == pe) {
-		tensorData.reset(data.release());
+		tensorData.reset(data.release(), std::default_delete<float[]>());
 		return true;
 	}
 
@@ -168,4 +139,43 @@ bool readTensorDataAsJson(const char *fileName, const TensorShape &shape, std::s
 
 }
 
+void compactFloat32(const float *data, uint16_t *compact, size_t size, ActivationStorage storage) {
+	uint16_t *c = compact;
+	switch (storage) {
+	case ActivationStorage_Float16:
+		for (auto datae = data+size; data<datae; c++) {
+			half_float::half h(*data++);
+			memcpy(c, &h, sizeof(*c));
+		}
+		break;
+	case ActivationStorage_BFloat16: // bfloat16 is the high half of float32, round to the nearest even
+		for (auto datae = data+size; data<datae; ) {
+			uint32_t u;
+			memcpy(&u, data++, sizeof(u));
+			*c++ = (u & 0x7fffffff) > 0x7f800000 ? (u >> 16) | 0x40/*keep NaN quiet*/ : (u + 0x7fff + ((u >> 16) & 1)) >> 16;
+		}
+		break;
+	default:
+		assert(false); // float32 isn't compacted
+	}
+}
+
+void expandToFloat32(const uint16_t *data, float *expanded, size_t size, ActivationStorage storage) {
+	float *e = expanded;
+	switch (storage) {
+	case ActivationStorage_Float16:
+		for (auto datae = data+size; data<datae; )
+			*e++ = *(const half_float::half*)data++;
+		break;
+	case ActivationStorage_BFloat16:
+		for (auto datae = data+size; data<datae; ) {
+			uint32_t u = uint32_t(*data++) << 16;
+			memcpy(e++, &u, sizeof(u));
+		}
+		break;
+	default:
+		assert(false); // float32 isn't compacted
+	}
+}
+
 }
@@ -1,19 +1,155 @@
 // Copyright (C) 2020 by Yuri Victorovich. All rights reserved.
 
+#pragma once
+
+#include "nn-types.h"
+#include "misc.h"
+
 #include <vector>
+#include <memory>
+#include <iterator>
+#include <initializer_list>
+#include <ostream>
+
+#include <stdint.h>
+#include <assert.h>
+
+// TensorShape keeps dimensions inline: shapes are created and copied in the computation loop, they shouldn't allocate
+class TensorShape {
+public:
+	enum {MaxRank = 8};
+
+	typedef unsigned                                value_type;
+	typedef unsigned*                               iterator;
+	typedef const unsigned*                         const_iterator;
+	typedef std::reverse_iterator<iterator>         reverse_iterator;
+	typedef std::reverse_iterator<const_iterator>   const_reverse_iterator;
+
+private:
+	unsigned dims[MaxRank];
+	unsigned rank;
+
+public:
+	constexpr TensorShape() : dims{}, rank(0) { }
+	constexpr TensorShape(std::initializer_list<unsigned> lst) : dims{}, rank(0) {
+		for (auto d : lst)
+			push_back(d);
+	}
+	template<typename It>
+	constexpr TensorShape(It b, It e) : dims{}, rank(0) {
+		for (; b != e; b++)
+			push_back(*b);
+	}
+
+	constexpr unsigned size() const {return rank;}
+	constexpr bool empty() const {return rank == 0;}
+	constexpr unsigned& operator[](unsigned i) {assert(i < rank); return dims[i];}
+	constexpr unsigned operator[](unsigned i) const {assert(i < rank); return dims[i];}
+
+	constexpr iterator begin() {return dims;}
+	constexpr iterator end() {return dims+rank;}
+	constexpr const_iterator begin() const {return dims;}
+	constexpr const_iterator end() const {return dims+rank;}
+	constexpr reverse_iterator rbegin() {return reverse_iterator(end());}
+	constexpr reverse_iterator rend() {return reverse_iterator(begin());}
+	constexpr const_reverse_iterator rbegin() const {return const_reverse_iterator(end());}
+	constexpr const_reverse_iterator rend() const {return const_reverse_iterator(begin());}
+
+	constexpr void push_back(unsigned d) {
+		if (rank == MaxRank)
+			tooManyDims();
+		dims[rank++] = d;
+	}
+	constexpr void resize(unsigned newRank, unsigned d = 0) {
+		if (newRank > MaxRank)
+			tooManyDims();
+		for (; rank < newRank; rank++)
+			dims[rank] = d;
+		rank = newRank;
+	}
+	constexpr iterator insert(iterator pos, unsigned d) {
+		if (rank == MaxRank)
+			tooManyDims();
+		for (auto p = end(); p > pos; p--)
+			*p = *(p-1);
+		*pos = d;
+		rank++;
+		return pos;
+	}
+	constexpr void dropFront(unsigned n) { // removes n leading dimensions
+		assert(n <= rank);
+		for (unsigned i = n; i < rank; i++)
+			dims[i-n] = dims[i];
+		rank -= n;
+	}
+
+	constexpr bool operator==(const TensorShape &other) const {
+		if (rank != other.rank)
+			return false;
+		for (unsigned i = 0; i < rank; i++)
+			if (dims[i] != other.dims[i])
+				return false;
+		return true;
+	}
+	constexpr bool operator!=(const TensorShape &other) const {return !(*this == other);}
 
-typedef std::vector<unsigned> TensorShape;
+private:
+	[[noreturn]] static void tooManyDims() {
+		FAIL("tensors with more than " << MaxRank << " dimensions aren't supported")
+	}
+};
+
+inline std::ostream& operator<<(std::ostream &os, const TensorShape &shape) {
+	os << "[";
+	unsigned idx = 0;
+	for (auto d : shape) {
+		if (idx++ != 0)
+			os << ',';
+		os << d;
+	}
+	os << "]";
+	return os;
+}
 
 namespace Tensor {
 
-size_t flatSize(const TensorShape &shape);
-unsigned numMultiDims(const TensorShape &shape);
-TensorShape getLastDims(const TensorShape &shape, unsigned ndims);
-TensorShape stripLeadingOnes(const TensorShape &shape);
+constexpr size_t flatSize(const TensorShape &shape) {
+	size_t sz = 1;
+	for (auto d : shape)
+		sz *= d;
+	return sz;
+}
+
+constexpr unsigned numMultiDims(const TensorShape &shape) {
+	unsigned numMultiDims = 0;
+	for (auto d : shape)
+		if (d > 1)
+			numMultiDims++;
+	return numMultiDims;
+}
+
+constexpr TensorShape getLastDims(const TensorShape &shape, unsigned ndims) {
+	TensorShape s = shape;
+	if (s.size() > ndims)
+		s.dropFront(s.size()-ndims);
+	return s;
+}
+
+constexpr TensorShape stripLeadingOnes(const TensorShape &shape) {
+	unsigned n = 0;
+	while (n < shape.size() && shape[n]==1)
+		n++;
+	TensorShape s = shape;
+	s.dropFront(n);
+	return s;
+}
+
 bool isSubset(const TensorShape &shapeLarge, const TensorShape &shapeSmall);
 float* computeArgMax(const TensorShape &inputShape, const float *input, const std::vector<float> &palette);
 bool canBeAnImage(const TensorShape &shape);
 void saveTensorDataAsJson(const TensorShape &shape, const float *data, const char *fileName);
 bool readTensorDataAsJson(const char *fileName, const TensorShape &shape, std::shared_ptr<const float> &tensorData);
+void compactFloat32(const float *data, uint16_t *compact, size_t size, ActivationStorage storage); // float32 -> float16/bfloat16
+void expandToFloat32(const uint16_t *data, float *expanded, size_t size, ActivationStorage storage); // float16/bfloat16 -> float32
 
 }
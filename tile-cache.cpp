@@ -0,0 +1,123 @@
+// Copyright (C) 2020 by Yuri Victorovich. All rights reserved.
+
+#include "tile-cache.h"
+
+#include <QPainter>
+
+#include <cmath>
+
+static const size_t maxQueueSize = 256; // older requests are dropped, they are probably for the area that isn't visible any more
+
+/// constructor
+
+TileCache::TileCache(unsigned numThreads, size_t capacity_, std::function<void()> tileReady_)
+: capacity(capacity_)
+, tileReady(tileReady_)
+, stopping(false)
+, generation(0)
+{
+	for (unsigned t = 0; t < numThreads; t++)
+		threads.emplace_back(&TileCache::loop, this);
+}
+
+TileCache::~TileCache() {
+	{
+		std::unique_lock<std::mutex> l(lock);
+		stopping = true;
+		condition.notify_all();
+	}
+	for (auto &t : threads)
+		t.join();
+}
+
+/// interface
+
+int TileCache::scaleToLevel(qreal scale) {
+	return (int)std::ceil(std::log2(scale)*LevelsPerOctave - 1e-6);
+}
+
+qreal TileCache::levelToScale(int level) {
+	return std::exp2(qreal(level)/LevelsPerOctave);
+}
+
+void TileCache::reset(ContentPainter painter_) {
+	std::unique_lock<std::mutex> l(lock);
+	generation++; // tiles being rendered now are discarded when they are done
+	painter = painter_;
+	tiles.clear();
+	tileIndex.clear();
+	queue.clear();
+	pending.clear();
+}
+
+QImage TileCache::get(const Key &key) {
+	std::unique_lock<std::mutex> l(lock);
+	auto it = tileIndex.find(key);
+	if (it != tileIndex.end()) {
+		tiles.splice(tiles.begin(), tiles, it->second);
+		return it->second->second;
+	}
+	if (painter && pending.find(key) == pending.end()) {
+		queue.push_front(key);
+		pending.insert(key);
+		if (queue.size() > maxQueueSize) {
+			pending.erase(queue.back());
+			queue.pop_back();
+		}
+		condition.notify_one();
+	}
+	return QImage();
+}
+
+QImage TileCache::peek(const Key &key) {
+	std::unique_lock<std::mutex> l(lock);
+	auto it = tileIndex.find(key);
+	return it != tileIndex.end() ? it->second->second : QImage();
+}
+
+/// internals
+
+void TileCache::loop() {
+	while (true) {
+		// take the newest request
+		Key key;
+		ContentPainter contentPainter;
+		unsigned gen;
+		{
+			std::unique_lock<std::mutex> l(lock);
+			condition.wait(l, [this]() {return stopping || !queue.empty();});
+			if (stopping)
+				return;
+			key = queue.front();
+			queue.pop_front();
+			contentPainter = painter;
+			gen = generation;
+		}
+
+		// render
+		auto scale = levelToScale(std::get<0>(key));
+		QImage image(TileSize, TileSize, QImage::Format_ARGB32_Premultiplied);
+		image.fill(Qt::transparent);
+		{
+			QPainter p(&image);
+			p.translate(-std::get<1>(key)*TileSize, -std::get<2>(key)*TileSize);
+			p.scale(scale, scale);
+			contentPainter(p, QRectF(std::get<1>(key)*TileSize/scale, std::get<2>(key)*TileSize/scale, TileSize/scale, TileSize/scale), scale);
+		}
+
+		// store it, least recently used tiles are evicted
+		{
+			std::unique_lock<std::mutex> l(lock);
+			if (gen != generation)
+				continue; // stale
+			pending.erase(key);
+			tiles.emplace_front(key, image);
+			tileIndex[key] = tiles.begin();
+			while (tiles.size() > capacity) {
+				tileIndex.erase(tiles.back().first);
+				tiles.pop_back();
+			}
+		}
+		tileReady();
+	}
+}
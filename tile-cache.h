@@ -0,0 +1,59 @@
+// Copyright (C) 2020 by Yuri Victorovich. All rights reserved.
+
+#pragma once
+
+#include <QImage>
+#include <QRectF>
+class QPainter;
+
+#include <map>
+#include <list>
+#include <deque>
+#include <set>
+#include <tuple>
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// TileCache rasterizes content into fixed-size tiles on its own threads and keeps the recently used tiles:
+// tiles are rendered for discrete zoom levels, level L is the scale of 2^(L/LevelsPerOctave),
+// a requested tile that isn't ready yet is queued, and the newest requests are rendered first
+class TileCache {
+public: // types
+	typedef std::function<void(QPainter &painter, const QRectF &rect, qreal scale)> ContentPainter; // paints rect in content coordinates, the painter is already scaled by scale
+	typedef std::tuple<int/*level*/, int/*x*/, int/*y*/> Key;
+
+	static constexpr int TileSize        = 256; // pixels
+	static constexpr int LevelsPerOctave = 4;
+
+private: // fields
+	size_t                                         capacity;   // in tiles
+	std::function<void()>                          tileReady;  // called on the rendering threads
+	std::vector<std::thread>                       threads;
+	std::mutex                                     lock;
+	std::condition_variable                        condition;
+	bool                                           stopping;
+	unsigned                                       generation; // content version
+	ContentPainter                                 painter;
+	std::list<std::pair<Key, QImage>>              tiles;      // most recently used first
+	std::map<Key, std::list<std::pair<Key, QImage>>::iterator> tileIndex;
+	std::deque<Key>                                queue;      // newest first
+	std::set<Key>                                  pending;    // queued or being rendered
+
+public: // constructor
+	TileCache(unsigned numThreads, size_t capacity_, std::function<void()> tileReady_);
+	~TileCache();
+
+public: // interface
+	static int scaleToLevel(qreal scale); // the level with the scale at or above scale, so that tiles are never enlarged much
+	static qreal levelToScale(int level);
+
+	void reset(ContentPainter painter_); // the content changed: all tiles are dropped
+	QImage get(const Key &key);  // returns the tile when it is ready, otherwise queues it and returns the null image
+	QImage peek(const Key &key); // returns the tile when it is ready, doesn't queue it
+
+private: // internals
+	void loop();
+};
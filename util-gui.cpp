@@ -0,0 +1,90 @@
+// Copyright (C) 2020 by Yuri Victorovich. All rights reserved.
+
+// GUI helpers from util.h, they are only linked into nn-insight so that the headless tools don't depend on Qt5::Widgets and Qt5::Svg
+
+#include "util.h"
+#include "misc.h"
+
+#include <QApplication>
+#include <QScreen>
+#include <QCursor>
+#include <QString>
+#include <QMessageBox>
+#include <QPixmap>
+#include <QGuiApplication>
+#include <QWindow>
+#include <QImage>
+#include <QByteArray>
+#include <QSize>
+#include <QPainter>
+#include <QSvgRenderer>
+#include <QComboBox>
+
+#include <vector>
+
+#include <unistd.h> // sleep
+#include <assert.h>
+
+namespace Util {
+
+bool warningOk(QWidget *parent, const QString &msg) {
+  QMessageBox::warning(parent, "Warning", msg, QMessageBox::Ok);
+  return false; // for convenience of callers
+}
+
+float getScreenDPI() {
+	static float dpi = QApplication::screens().at(0)->logicalDotsPerInch();
+	return dpi;
+}
+
+QPoint getGlobalMousePos() {
+	return QCursor::pos(QApplication::screens().at(0));
+}
+
+QPixmap getScreenshot(bool hideOurWindows) {
+	QScreen *screen = QGuiApplication::primaryScreen();
+
+	std::vector<QWidget*> windowsToHide = hideOurWindows ? std::vector<QWidget*>{QApplication::activeWindow()} : std::vector<QWidget*>{};
+	for (auto w : windowsToHide)
+		w->hide();
+
+	QApplication::beep(); // ha ha
+
+	if (!windowsToHide.empty()) {
+		QCoreApplication::processEvents();
+		::sleep(1); // without this sleep screen doesn't have enough time to hide our window when complex windows are behind (like a browser)
+	}
+
+	auto pixmap = screen->grabWindow(0);
+
+	for (auto w : windowsToHide)
+		w->show();
+
+	return pixmap;
+}
+
+QImage svgToImage(const QByteArray& svgContent, const QSize& size, QPainter::CompositionMode mode) {
+	QImage image(size.width(), size.height(), QImage::Format_ARGB32);
+
+	QPainter painter(&image);
+	painter.setCompositionMode(mode);
+	image.fill(Qt::transparent);
+	QSvgRenderer(svgContent).render(&painter);
+
+	return image;
+}
+
+void selectComboBoxItemWithItemData(QComboBox &comboBox, int value) {
+	for (unsigned i=0, ie=comboBox.count(); i<ie; i++)
+		if (comboBox.itemData(i).toInt() == value) {
+			comboBox.setCurrentIndex(i);
+			return;
+		}
+	assert(false); // item with itemData=value not found
+}
+
+void setWidgetColor(QWidget *widget, const char *color) {
+	widget->setStyleSheet(S2Q(STR("color: " << color)));
+}
+
+}
@@ -3,28 +3,15 @@
 #include "util.h"
 #include "misc.h"
 
-#include <QApplication>
-#include <QScreen>
-#include <QCursor>
 #include <QString>
-#include <QMessageBox>
 #include <QFile>
-#include <QPixmap>
-#include <QGuiApplication>
-#include <QWindow>
 #include <QStringList>
-#include <QImage>
-#include <QByteArray>
-#include <QSize>
-#include <QPainter>
-#include <QSvgRenderer>
-#include <QComboBox>
 
 #include <limits>
 #include <cstring>
 #include <memory>
 
-#include <unistd.h> // sleep,readlink
+#include <unistd.h> // readlink
 #include <sys/stat.h>
 #include <assert.h>
 
@@ -34,20 +21,6 @@ std::string QStringToStlString(const QString &qs) {
 	return std::string(qs.toUtf8().constData());
 }
 
-bool warningOk(QWidget *parent, const QString &msg) {
-  QMessageBox::warning(parent, "Warning", msg, QMessageBox::Ok);
-  return false; // for convenience of callers
-}
-
-float getScreenDPI() {
-	static float dpi = QApplication::screens().at(0)->logicalDotsPerInch();
-	return dpi;
-}
-
-QPoint getGlobalMousePos() {
-	return QCursor::pos(QApplication::screens().at(0));
-}
-
 std::string formatUIntHumanReadable(size_t u) {
 	if (u <= 999)
 		return STR(u);
@@ -99,38 +72,6 @@ size_t getFileSize(const QString &fileName) {
 	return size;
 }
 
-QPixmap getScreenshot(bool hideOurWindows) {
-	QScreen *screen = QGuiApplication::primaryScreen();
-
-	std::vector<QWidget*> windowsToHide = hideOurWindows ? std::vector<QWidget*>{QApplication::activeWindow()} : std::vector<QWidget*>{};
-	for (auto w : windowsToHide)
-		w->hide();
-
-	QApplication::beep(); // ha ha
-
-	if (!windowsToHide.empty()) {
-		QCoreApplication::processEvents();
-		::sleep(1); // without this sleep screen doesn't have enough time to hide our window when complex windows are behind (like a browser)
-	}
-
-	auto pixmap = screen->grabWindow(0);
-
-	for (auto w : windowsToHide)
-		w->show();
-
-	return pixmap;
-}
-
-unsigned char* convertArrayFloatToUInt8(const float *a, size_t size) { // ASSUME that a is normalized to 0..255
-	std::unique_ptr<unsigned char> cc(new unsigned char[size]);
-
-	auto c = cc.get();
-	for (const float *ae = a+size; a<ae; )
-		*c++ = *a++;
-
-	return cc.release();
-}
-
 bool doesFileExist(const char *filePath) {
 	struct stat s;
 	return ::stat(filePath, &s)==0 && (s.st_mode&S_IFREG);
@@ -164,30 +105,6 @@ std::string getMyOwnExecutablePath() {
 	return buf;
 }
 
-QImage svgToImage(const QByteArray& svgContent, const QSize& size, QPainter::CompositionMode mode) {
-	QImage image(size.width(), size.height(), QImage::Format_ARGB32);
-
-	QPainter painter(&image);
-	painter.setCompositionMode(mode);
-	image.fill(Qt::transparent);
-	QSvgRenderer(svgContent).render(&painter);
-
-	return image;
-}
-
-void selectComboBoxItemWithItemData(QComboBox &comboBox, int value) {
-	for (unsigned i=0, ie=comboBox.count(); i<ie; i++)
-		if (comboBox.itemData(i).toInt() == value) {
-			comboBox.setCurrentIndex(i);
-			return;
-		}
-	assert(false); // item with itemData=value not found
-}
-
-void setWidgetColor(QWidget *widget, const char *color) {
-	widget->setStyleSheet(S2Q(STR("color: " << color)));
-}
-
 std::string charToSubscript(char ch) {
 	switch (ch) {
 	case '0': return STR("₀");
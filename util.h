@@ -25,9 +25,6 @@ class QWidget;
 namespace Util {
 
 std::string QStringToStlString(const QString &qs);
-bool warningOk(QWidget *parent, const QString &msg);
-float getScreenDPI();
-QPoint getGlobalMousePos();
 std::string formatUIntHumanReadable(size_t u);
 std::string formatUIntHumanReadableSuffixed(size_t u);
 std::string formatFlops(size_t flops);
@@ -46,16 +43,20 @@ std::tuple<T,T> arrayMinMax(const T *arr, size_t len) {
 
 float* copyFpArray(const float *a, size_t sz);
 size_t getFileSize(const QString &fileName);
-QPixmap getScreenshot(bool hideOurWindows);
-unsigned char* convertArrayFloatToUInt8(const float *a, size_t size);
 bool doesFileExist(const char *filePath);
 QStringList readListFromFile(const char *fileName);
 std::string getMyOwnExecutablePath();
+std::string charToSubscript(char ch);
+std::string stringToSubscript(const std::string &str);
+
+// GUI helpers (util-gui.cpp), they aren't available in headless tools
+bool warningOk(QWidget *parent, const QString &msg);
+float getScreenDPI();
+QPoint getGlobalMousePos();
+QPixmap getScreenshot(bool hideOurWindows);
 QImage svgToImage(const QByteArray& svgContent, const QSize& size, QPainter::CompositionMode mode);
 void selectComboBoxItemWithItemData(QComboBox &comboBox, int value);
 void setWidgetColor(QWidget *widget, const char *color);
-std::string charToSubscript(char ch);
-std::string stringToSubscript(const std::string &str);
 
 template<typename T>
 bool isValueIn(const std::vector<T> &v, T val) {
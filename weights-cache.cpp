@@ -0,0 +1,108 @@
+// Copyright (C) 2020 by Yuri Victorovich. All rights reserved.
+
+#include "weights-cache.h"
+#include "misc.h"
+
+#include <string>
+#include <functional>
+#include <iomanip>
+
+#include <stdlib.h>
+#include <limits.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+/// local helpers
+
+static std::shared_ptr<const float> mapFile(int fd, size_t bytes, int prot) {
+	void *m = ::mmap(0/*addr*/, bytes, prot, MAP_SHARED/*flags*/, fd, 0/*offset*/);
+	if (m == MAP_FAILED)
+		return nullptr;
+	return std::shared_ptr<const float>(static_cast<const float*>(m), [bytes](const float *p) {
+		if (::munmap(const_cast<float*>(p), bytes) == -1)
+			WARNING("failed to unmmap the cached weights: " << strerror(errno))
+	});
+}
+
+static bool makeDirectory(const std::string &dir) {
+	if (::mkdir(dir.c_str(), 0755) == -1 && errno != EEXIST) {
+		WARNING("failed to create the weights cache directory '" << dir << "': " << strerror(errno))
+		return false;
+	}
+	return true;
+}
+
+/// constructor
+
+WeightsCache::WeightsCache(const std::string &dir_)
+: dir(dir_)
+{
+}
+
+std::shared_ptr<WeightsCache> WeightsCache::forModelFile(const std::string &cacheDir, const std::string &modelFileName) {
+	// identify the model file by its location and version: a changed file gets a different directory
+	char path[PATH_MAX];
+	struct stat sb;
+	if (!::realpath(modelFileName.c_str(), path) || ::stat(path, &sb) == -1) {
+		WARNING("failed to find the model file '" << modelFileName << "' for the weights cache: " << strerror(errno))
+		return nullptr;
+	}
+	auto id = std::hash<std::string>()(STR(path << ':' << sb.st_size << ':' << sb.st_mtim.tv_sec << '.' << sb.st_mtim.tv_nsec));
+
+	auto dir = STR(cacheDir << "/" << std::hex << std::setw(16) << std::setfill('0') << id);
+	if (!makeDirectory(cacheDir) || !makeDirectory(dir))
+		return nullptr;
+	return std::shared_ptr<WeightsCache>(new WeightsCache(dir));
+}
+
+/// interface
+
+std::shared_ptr<const float> WeightsCache::get(unsigned key, size_t numElements, std::function<void(float*)> fill) {
+	size_t bytes = numElements*sizeof(float);
+	auto fileName = STR(dir << "/tensor-" << key << ".f32");
+
+	// already published by this or another process?
+	int fd = ::open(fileName.c_str(), O_RDONLY|O_CLOEXEC);
+	if (fd != -1) {
+		struct stat sb;
+		std::shared_ptr<const float> m;
+		if (::fstat(fd, &sb) == 0 && size_t(sb.st_size) == bytes)
+			m = mapFile(fd, bytes, PROT_READ);
+		::close(fd); // the mapping keeps the file
+		if (m)
+			return m;
+		WARNING("ignoring the broken weights cache file '" << fileName << "'")
+	}
+
+	// convert into a temporary file and publish it atomically: other processes see either no file or the complete one
+	auto tmpFileName = STR(dir << "/.tensor-" << key << ".XXXXXX");
+	fd = ::mkstemp(&tmpFileName[0]);
+	if (fd == -1) {
+		WARNING("failed to create the weights cache file '" << tmpFileName << "': " << strerror(errno))
+		return nullptr;
+	}
+	if (int err = ::posix_fallocate(fd, 0, bytes)) { // allocate the blocks now: writing into a sparse file on a full disk would raise SIGBUS
+		WARNING("failed to allocate " << bytes << " bytes for the weights cache file '" << tmpFileName << "': " << strerror(err))
+		::close(fd);
+		::unlink(tmpFileName.c_str());
+		return nullptr;
+	}
+	auto m = mapFile(fd, bytes, PROT_READ|PROT_WRITE);
+	::close(fd);
+	if (!m) {
+		WARNING("failed to map the weights cache file '" << tmpFileName << "': " << strerror(errno))
+		::unlink(tmpFileName.c_str());
+		return nullptr;
+	}
+	fill(const_cast<float*>(m.get()));
+	::chmod(tmpFileName.c_str(), 0644); // mkstemp creates files only readable by the owner
+	if (::rename(tmpFileName.c_str(), fileName.c_str()) == -1) {
+		WARNING("failed to publish the weights cache file '" << fileName << "': " << strerror(errno))
+		::unlink(tmpFileName.c_str()); // the mapping is still usable by this process
+	}
+	return m;
+}
@@ -0,0 +1,23 @@
+// Copyright (C) 2020 by Yuri Victorovich. All rights reserved.
+
+#pragma once
+
+#include <string>
+#include <memory>
+#include <functional>
+
+#include <stddef.h>
+
+// WeightsCache keeps weights derived from one model file (ex. dequantized weights) in files under the cache directory:
+// processes serving the same model map the same files and share their physical pages instead of keeping private copies
+class WeightsCache {
+	std::string dir; // directory for this version of the model file
+
+	WeightsCache(const std::string &dir_);
+
+public:
+	static std::shared_ptr<WeightsCache> forModelFile(const std::string &cacheDir, const std::string &modelFileName); // returns nullptr when the cache can't be used
+
+	// returns the mapped cached buffer, it is filled by fill() and published on first use, returns nullptr on failure
+	std::shared_ptr<const float> get(unsigned key, size_t numElements, std::function<void(float*)> fill);
+};
@@ -5,35 +5,46 @@
 #include <QDebug>
 #include <QMouseEvent>
 #include <QWheelEvent>
+#include <QPaintEvent>
+#include <QPainter>
 #include <QPointF>
+#include <QRectF>
+#include <QSizeF>
+#include <QFile>
+#include <QMetaObject>
 #include <QApplication>
 #include <QDebug>
 
+#include <cmath>
+#include <mutex>
+
 #include "misc.h"
 #include "util.h"
+#include "parallel.h"
 
 ZoomableSvgWidget::ZoomableSvgWidget(QWidget *parent)
 : QSvgWidget(parent)
 , scalingFactor(1.)
 , mousePressed(false)
+, tileCache(new TileCache(std::max(1u, Parallel::numThreads()/2), 256/*tiles, 64MB*/, [this]() {
+	QMetaObject::invokeMethod(this, [this]() {update();}, Qt::QueuedConnection);
+}))
 { }
 
 /// mirroring 'load' functions
 
 void ZoomableSvgWidget::load(const QString &file) {
-	// pass
-	QSvgWidget::load(file);
-
-	// fix widget size
-	fixWindowSize(renderer()->defaultSize());
+	QFile f(file);
+	load(f.open(QIODevice::ReadOnly) ? f.readAll() : QByteArray());
 }
 
 void ZoomableSvgWidget::load(const QByteArray &contents) {
 	// pass
 	QSvgWidget::load(contents);
+	svgContents = contents;
 
 	// fix widget size
-	fixWindowSize(renderer()->defaultSize());
+	contentChanged();
 }
 
 /// interface for descendants
@@ -42,6 +53,34 @@ double ZoomableSvgWidget::getScalingFactor() const {
 	return scalingFactor;
 }
 
+void ZoomableSvgWidget::contentChanged() {
+	tileCache->reset(getContentPainter());
+	fixWindowSize((getContentSize()*scalingFactor).toSize());
+	update();
+}
+
+/// content
+
+QSizeF ZoomableSvgWidget::getContentSize() const {
+	return renderer()->defaultSize();
+}
+
+TileCache::ContentPainter ZoomableSvgWidget::getContentPainter() const {
+	// QSvgRenderer can't be used concurrently: tiles are rendered by a separate renderer one at a time
+	auto svgRenderer = std::make_shared<QSvgRenderer>(svgContents);
+	auto svgRendererLock = std::make_shared<std::mutex>();
+	return [svgRenderer,svgRendererLock](QPainter &painter, const QRectF &rect, qreal scale) {
+		UNUSED(rect) // QSvgRenderer can't render only a part of the image
+		UNUSED(scale)
+		std::unique_lock<std::mutex> l(*svgRendererLock);
+		svgRenderer->render(&painter, QRectF(QPointF(0,0), svgRenderer->defaultSize()));
+	};
+}
+
+void ZoomableSvgWidget::paintOverlay(QPainter &painter) const {
+	UNUSED(painter) // nothing by default
+}
+
 /// overridables
 
 void ZoomableSvgWidget::mousePressEvent(QMouseEvent* event) {
@@ -75,7 +114,7 @@ void ZoomableSvgWidget::wheelEvent(QWheelEvent* event) {
 		double angle = event->angleDelta().y();
 		scalingFactor *= 1 + (angle/360*0.1);
 		auto posOld = mapFromGlobal(QCursor::pos(QApplication::screens().at(0)));
-		fixWindowSize(renderer()->defaultSize()*scalingFactor);
+		fixWindowSize((getContentSize()*scalingFactor).toSize());
 		auto posNew = mapFromGlobal(QCursor::pos(QApplication::screens().at(0)));
 		qDebug() << "posMove=" << (posNew-posOld);
 		event->accept();
@@ -85,6 +124,63 @@ void ZoomableSvgWidget::wheelEvent(QWheelEvent* event) {
 	}
 }
 
+void ZoomableSvgWidget::paintEvent(QPaintEvent *event) {
+	// tiles are rendered for the zoom level at or above the current scale and are scaled down to it
+	const int tileSize = TileCache::TileSize;
+	int level = TileCache::scaleToLevel(scalingFactor);
+	qreal levelScale = TileCache::levelToScale(level);
+	QPainter painter(this);
+	painter.setRenderHint(QPainter::SmoothPixmapTransform);
+	painter.scale(scalingFactor/levelScale, scalingFactor/levelScale);
+
+	// only tiles in the exposed area are painted: in a scroll area it is the visible part of the widget
+	QRectF rect = QRectF(event->rect());
+	rect = QRectF(rect.topLeft()*(levelScale/scalingFactor), rect.size()*(levelScale/scalingFactor));
+	auto tileRange = [tileSize](const QRectF &r, int &x0, int &y0, int &x1, int &y1) {
+		x0 = (int)std::floor(r.left()/tileSize);
+		y0 = (int)std::floor(r.top()/tileSize);
+		x1 = (int)std::ceil(r.right()/tileSize) - 1;
+		y1 = (int)std::ceil(r.bottom()/tileSize) - 1;
+	};
+	int tx0, ty0, tx1, ty1;
+	tileRange(rect, tx0, ty0, tx1, ty1);
+	for (int ty = ty0; ty <= ty1; ty++)
+		for (int tx = tx0; tx <= tx1; tx++) {
+			QRectF tileRect(tx*tileSize, ty*tileSize, tileSize, tileSize);
+			auto tile = tileCache->get({level, tx, ty});
+			if (!tile.isNull()) {
+				painter.drawImage(tileRect.topLeft(), tile);
+				continue;
+			}
+
+			// until the tile is ready, parts of tiles from the nearest coarser level that has them are enlarged in its place
+			for (int l = level-1; l >= level - 3*TileCache::LevelsPerOctave; l--) {
+				qreal k = TileCache::levelToScale(l)/levelScale;
+				QRectF r(tileRect.topLeft()*k, tileRect.size()*k); // in pixels of the level l
+				int cx0, cy0, cx1, cy1;
+				tileRange(r, cx0, cy0, cx1, cy1);
+				bool found = false;
+				for (int cy = cy0; cy <= cy1; cy++)
+					for (int cx = cx0; cx <= cx1; cx++) {
+						auto coarse = tileCache->peek({l, cx, cy});
+						if (coarse.isNull())
+							continue;
+						QRectF part = r.intersected(QRectF(cx*tileSize, cy*tileSize, tileSize, tileSize));
+						painter.drawImage(QRectF(part.topLeft()/k, part.size()/k), coarse, part.translated(-cx*tileSize, -cy*tileSize));
+						found = true;
+					}
+				if (found)
+					break;
+			}
+		}
+
+	// overlay: highlights and other things that change too often to be in tiles
+	painter.resetTransform();
+	painter.setRenderHint(QPainter::Antialiasing);
+	painter.scale(scalingFactor, scalingFactor);
+	paintOverlay(painter);
+}
+
 /// internals
 
 void ZoomableSvgWidget::fixWindowSize(QSize sz) {
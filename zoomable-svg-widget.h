@@ -2,14 +2,23 @@
 
 #pragma once
 
+#include "tile-cache.h"
+
 #include <QSvgWidget>
+#include <QByteArray>
 #include <QSize>
 #include <QPoint>
 #include <QPointF>
+
+#include <memory>
+
 class QString;
-class QByteArray;
 class QMouseEvent;
 class QWheelEvent;
+class QPaintEvent;
+class QPainter;
+class QRectF;
+class QSizeF;
 
 class ZoomableSvgWidget : public QSvgWidget {
 	Q_OBJECT
@@ -17,6 +26,8 @@ class ZoomableSvgWidget : public QSvgWidget {
 	double        scalingFactor;
 	bool          mousePressed;
 	QPoint        lastMousePos;
+	QByteArray    svgContents;
+	std::unique_ptr<TileCache> tileCache; // the content is painted from tiles that are rasterized in the background
 
 public:
 	ZoomableSvgWidget(QWidget *parent);
@@ -27,12 +38,19 @@ protected: // mirroring 'load' functions
 
 protected: // interface for descendants
 	double getScalingFactor() const;
+	void contentChanged(); // resizes the widget for the new content
+
+protected: // content: descendants can paint their content themselves instead of loading SVG
+	virtual QSizeF getContentSize() const; // unscaled
+	virtual TileCache::ContentPainter getContentPainter() const; // the returned function is called on the tile rendering threads
+	virtual void paintOverlay(QPainter &painter) const; // paints over the tiles on the GUI thread, the painter is scaled to the content coordinates
 
 protected: // overridables
 	void mousePressEvent(QMouseEvent* event);
 	void mouseReleaseEvent(QMouseEvent* event);
 	void mouseMoveEvent(QMouseEvent* event);
 	void wheelEvent(QWheelEvent* event);
+	void paintEvent(QPaintEvent *event) override;
 
 
 private: // internals